@@ -4,5 +4,5 @@
 #include "../interface/laser.glslh"
 
 void main(void) {
-	fragColor = r_color * texture(tex, texCoord);
+	fragColor = color * texture(tex, texCoord);
 }
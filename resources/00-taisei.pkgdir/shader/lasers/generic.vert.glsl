@@ -7,7 +7,8 @@
 #include "vertex_pos.glslh"
 
 void main(void) {
-    vec2 pos     = laser_vertex_pos(instance_pos_delta.xy, instance_pos_delta.zw, instance_width);
+    vec2 pos     = laser_vertex_pos(instance_pos_delta.xy, instance_pos_delta.zw, instance_width.x, instance_width.y);
     gl_Position  = r_projectionMatrix * r_modelViewMatrix * vec4(pos, 0.0, 1.0);
     texCoord     = texCoordRawIn;
+    color        = instance_color;
 }
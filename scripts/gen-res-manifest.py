@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+
+from taiseilib.common import (
+    DirPathType,
+    add_common_args,
+    run_main,
+    update_text_file,
+    write_depfile,
+)
+
+from taiseilib.resmanifest import (
+    generate_manifest,
+)
+
+from pathlib import Path
+
+
+def main(args):
+    import argparse
+    parser = argparse.ArgumentParser(description='Generate a resource manifest for a package directory.', prog=args[0])
+
+    parser.add_argument('directory',
+        type=DirPathType,
+        help='the source package directory'
+    )
+
+    parser.add_argument('output',
+        type=Path,
+        help='the output manifest path'
+    )
+
+    add_common_args(parser, depfile=True)
+
+    args = parser.parse_args(args[1:])
+    text, dependencies = generate_manifest(args.directory)
+    update_text_file(args.output, text)
+
+    if args.depfile is not None:
+        dependencies.append(Path(__file__).resolve())
+        write_depfile(args.depfile, args.output, dependencies)
+
+
+if __name__ == '__main__':
+    run_main(main)
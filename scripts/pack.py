@@ -32,6 +32,11 @@ from taiseilib.common import (
     write_depfile,
 )
 
+from taiseilib.resmanifest import (
+    MANIFEST_NAME,
+    generate_manifest,
+)
+
 
 zstd_decompressor = zstandard.ZstdDecompressor()
 
@@ -128,6 +133,9 @@ def pack(args):
             if path.name[0] == '.' or any(path.match(x) for x in args.exclude):
                 continue
 
+            if args.manifest and path == args.directory / MANIFEST_NAME:
+                continue
+
             relpath = path.relative_to(args.directory)
 
             if path.is_dir():
@@ -152,6 +160,12 @@ def pack(args):
                     log_file(path, relpath, ctype)
                     zf.write(str(path), str(relpath), compress_type=ctype)
 
+        if args.manifest:
+            manifest, manifest_deps = generate_manifest(args.directory)
+            log_file('<generated>', MANIFEST_NAME, comp_type)
+            zf.writestr(MANIFEST_NAME, manifest, compress_type=comp_type)
+            dependencies += manifest_deps
+
     if args.depfile is not None:
         if nocompress_file is not None:
             dependencies.append(nocompress_file)
@@ -179,6 +193,11 @@ def main(args):
         help='file exclusion pattern'
     )
 
+    parser.add_argument('--manifest',
+        action='store_true',
+        help='generate a resource manifest and add it to the archive'
+    )
+
     add_common_args(parser, depfile=True)
 
     args = parser.parse_args(args[1:])
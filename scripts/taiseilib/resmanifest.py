@@ -0,0 +1,193 @@
+
+'''
+Generates the resource manifest: a list of resources found in a package directory, along with their
+on-disk sizes and the other resources they depend on. The game uses it to schedule the whole
+dependency graph for loading up front, instead of discovering it one level at a time.
+
+Format, one resource per line:
+
+    <type> <name> <size> [<type>:<name> ...]
+
+This must stay in sync with src/resource/manifest.c.
+'''
+
+from pathlib import Path
+
+import re
+
+
+MANIFEST_NAME = 'manifest.txt'
+
+IMAGE_SUFFIXES = ('.png', '.webp', '.basis', '.basis.zst')
+AUDIO_SUFFIXES = ('.opus', '.ogg', '.wav', '.flac', '.mp3', '.mod', '.xm', '.s3m', '.it')
+
+
+class Entry(object):
+    def __init__(self, type, name, size=0):
+        self.type = type
+        self.name = name
+        self.size = size
+        self.deps = []
+
+    def add_dep(self, type, name):
+        if (type, name) not in self.deps:
+            self.deps.append((type, name))
+
+
+def parse_keyvalue(path):
+    result = {}
+
+    for line in path.read_text().split('\n'):
+        line = line.strip()
+
+        if not line or line.startswith('#'):
+            continue
+
+        key, sep, value = line.partition('=')
+
+        if sep:
+            result[key.strip()] = value.strip()
+
+    return result
+
+
+def strip_suffixes(name, suffixes):
+    for suffix in sorted(suffixes, key=len, reverse=True):
+        if name.endswith(suffix):
+            return name[:-len(suffix)]
+
+    return None
+
+
+def res_name(subdir, path, suffixes):
+    return strip_suffixes(path.relative_to(subdir).as_posix(), suffixes)
+
+
+def file_size(path):
+    try:
+        return path.stat().st_size
+    except FileNotFoundError:
+        return 0
+
+
+class Manifest(object):
+    def __init__(self, pkgdir):
+        self.pkgdir = Path(pkgdir)
+        self.entries = {}
+        self.dependencies = []
+
+    def entry(self, type, name):
+        key = (type, name)
+
+        try:
+            return self.entries[key]
+        except KeyError:
+            e = self.entries[key] = Entry(type, name)
+            return e
+
+    def files(self, subdir, suffixes):
+        d = self.pkgdir / subdir
+
+        for path in sorted(d.glob('**/*')):
+            if path.is_file() and path.name[0] != '.' and strip_suffixes(path.name, suffixes) is not None:
+                self.dependencies.append(path)
+                yield d, path
+
+    def res_path(self, vfs_path):
+        # Paths inside resource definitions are relative to the package root mounted at res/
+        if vfs_path.startswith('res/'):
+            return self.pkgdir / vfs_path[4:]
+
+        return self.pkgdir / vfs_path
+
+    def scan_textures(self):
+        for d, path in self.files('gfx', IMAGE_SUFFIXES):
+            name = res_name(d, path, IMAGE_SUFFIXES)
+
+            if name.endswith('.alphamap'):
+                continue
+
+            e = self.entry('texture', name)
+            e.size = max(e.size, file_size(path))
+
+        for d, path in self.files('gfx', ('.tex',)):
+            e = self.entry('texture', res_name(d, path, ('.tex',)))
+            kv = parse_keyvalue(path)
+            e.size = file_size(path) + sum(file_size(self.res_path(kv[k])) for k in ('source', 'alphamap') if k in kv)
+
+    def scan_sprites(self):
+        # Every texture can be loaded as a sprite that covers all of it.
+        for (type, name), e in list(self.entries.items()):
+            if type == 'texture':
+                self.entry('sprite', name).add_dep('texture', name)
+
+        for d, path in self.files('gfx', ('.spr',)):
+            name = res_name(d, path, ('.spr',))
+            e = self.entry('sprite', name)
+            e.size = file_size(path)
+            e.deps.clear()
+            e.add_dep('texture', parse_keyvalue(path).get('texture', name))
+
+    def scan_animations(self):
+        for d, path in self.files('gfx', ('.ani',)):
+            name = res_name(d, path, ('.ani',))
+            e = self.entry('animation', name)
+            e.size = file_size(path)
+            count = int(parse_keyvalue(path).get('@sprite_count', 0))
+
+            for i in range(count):
+                e.add_dep('sprite', '%s.frame%04d' % (name, i))
+
+    def scan_shaders(self):
+        for d, path in self.files('shader', ('.glsl',)):
+            self.entry('shader_object', res_name(d, path, ('.glsl',))).size = file_size(path)
+
+        for d, path in self.files('shader', ('.prog',)):
+            e = self.entry('shader_program', res_name(d, path, ('.prog',)))
+            e.size = file_size(path)
+            kv = parse_keyvalue(path)
+
+            for obj in kv.get('objects', kv.get('glsl_objects', '')).split():
+                e.add_dep('shader_object', obj)
+
+    def scan_simple(self, type, subdir, suffixes):
+        for d, path in self.files(subdir, suffixes):
+            self.entry(type, res_name(d, path, suffixes)).size = file_size(path)
+
+    def scan(self):
+        self.scan_textures()
+        self.scan_sprites()
+        self.scan_animations()
+        self.scan_shaders()
+        self.scan_simple('sfx', 'sfx', AUDIO_SUFFIXES)
+        self.scan_simple('bgm', 'bgm', AUDIO_SUFFIXES)
+        self.scan_simple('model', 'models', ('.iqm',))
+        self.scan_simple('font', 'fonts', ('.font',))
+        self.scan_simple('postprocess', 'shader', ('.pp',))
+        return self
+
+    def render(self):
+        lines = [
+            '# Generated by the Taisei build system, do not modify',
+            '# <type> <name> <size> [<type>:<name> ...]',
+        ]
+
+        for (type, name), e in sorted(self.entries.items()):
+            if re.search(r'\s', name) or any(re.search(r'\s', dname) for dtype, dname in e.deps):
+                raise ValueError('Resource names must not contain whitespace: %r' % name)
+
+            lines.append(' '.join(
+                [type, name, str(e.size)] +
+                ['%s:%s' % dep for dep in e.deps]
+            ))
+
+        return '\n'.join(lines) + '\n'
+
+
+def generate_manifest(pkgdir):
+    '''
+    Returns a tuple of the manifest text and the list of files it was generated from.
+    '''
+
+    m = Manifest(pkgdir).scan()
+    return m.render(), m.dependencies
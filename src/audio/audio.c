@@ -31,7 +31,7 @@ static struct {
 } audio;
 
 static bool is_skip_mode(void) {
-	return global.frameskip || stage_is_skip_mode();
+	return global.frameskip || stage_is_skip_mode() || stage_is_replay_seeking();
 }
 
 static SFXPlayID play_sound_internal(const char *name, bool is_ui, int cooldown, bool replace, int delay) {
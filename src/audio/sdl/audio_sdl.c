@@ -11,7 +11,9 @@
 #include "../backend.h"
 #include "../stream/stream.h"
 #include "../stream/stream_pcm.h"
+#include "../stream/stream_prefetch.h"
 #include "../stream/player.h"
+#include "sfx_cache.h"
 
 #include "util.h"
 #include "rwops/rwops_autobuf.h"
@@ -23,6 +25,9 @@
 
 #define CHAN_BGM 0
 
+// How far ahead of playback BGM is decoded, in seconds.
+#define BGM_PREFETCH_TIME 1.0
+
 #define NUM_BGM_CHANNELS 1
 #define NUM_SFX_MAIN_CHANNELS 28
 #define NUM_SFX_UI_CHANNELS 4
@@ -58,6 +63,7 @@ struct SFXImpl {
 
 struct BGM {
 	AudioStream stream;
+	bool prefetched;
 };
 
 static_assert(offsetof(BGM, stream) == 0, "");
@@ -71,6 +77,7 @@ static struct {
 
 	AudioStreamSpec spec;
 	SDL_AudioDeviceID audio_device;
+	uint32_t chunk_size;
 	uint8_t silence;
 } mixer;
 
@@ -143,6 +150,7 @@ static bool init_audio_device(void) {
 	}
 
 	mixer.spec = astream_spec(have.format, have.channels, have.freq);
+	mixer.chunk_size = have.size;
 	mixer.silence = have.silence;
 
 	return true;
@@ -160,17 +168,17 @@ static void shutdown_players(void) {
 }
 
 static bool init_players(void) {
-	if(!splayer_init(&mixer.players[G_BGM], NUM_BGM_CHANNELS, &mixer.spec)) {
+	if(!splayer_init(&mixer.players[G_BGM], NUM_BGM_CHANNELS, &mixer.spec, mixer.chunk_size)) {
 		log_error("splayer_init() failed");
 		return false;
 	}
 
-	if(!splayer_init(&mixer.players[G_SFX_MAIN], NUM_SFX_MAIN_CHANNELS, &mixer.spec)) {
+	if(!splayer_init(&mixer.players[G_SFX_MAIN], NUM_SFX_MAIN_CHANNELS, &mixer.spec, mixer.chunk_size)) {
 		log_error("splayer_init() failed");
 		return false;
 	}
 
-	if(!splayer_init(&mixer.players[G_SFX_UI], NUM_SFX_UI_CHANNELS, &mixer.spec)) {
+	if(!splayer_init(&mixer.players[G_SFX_UI], NUM_SFX_UI_CHANNELS, &mixer.spec, mixer.chunk_size)) {
 		log_error("splayer_init() failed");
 		return false;
 	}
@@ -258,6 +266,11 @@ static bool audio_sdl_bgm_set_global_volume(double gain) {
 
 static bool audio_sdl_bgm_play(BGM *bgm, bool loop, double position, double fadein) {
 	lock_audio();
+
+	if(bgm->prefetched) {
+		astream_prefetch_set_looping(&bgm->stream, loop);
+	}
+
 	bool status = splayer_play(&mixer.players[G_BGM], CHAN_BGM, &bgm->stream, loop, 1, position, fadein);
 	unlock_audio();
 	return status;
@@ -595,18 +608,43 @@ static BGM *audio_sdl_bgm_load(const char *vfspath) {
 		return NULL;
 	}
 
-	BGM *bgm = calloc(1, sizeof(*bgm));
+	AudioStream source;
 
-	if(!astream_open(&bgm->stream, rw, vfspath)) {
+	if(!astream_open(&source, rw, vfspath)) {
 		SDL_RWclose(rw);
-		free(bgm);
 		return NULL;
 	}
 
+	BGM *bgm = calloc(1, sizeof(*bgm));
+
+	// Decode on a separate thread, so that the audio callback only has to mix.
+	if(env_get("TAISEI_BGM_PREFETCH", true)) {
+		bgm->prefetched = astream_prefetch_open(&bgm->stream, &source, &mixer.spec, BGM_PREFETCH_TIME);
+	}
+
+	if(!bgm->prefetched) {
+		bgm->stream = source;
+	}
+
 	log_debug("Loaded stream from %s", vfspath);
 	return bgm;
 }
 
+static void audio_sdl_bgm_report_stats(BGM *bgm) {
+	if(!bgm->prefetched) {
+		return;
+	}
+
+	AudioStreamPrefetchStats stats;
+	astream_prefetch_get_stats(&bgm->stream, &stats);
+
+	LogLevel lvl = stats.num_underruns ? LOG_WARN : LOG_DEBUG;
+	log_custom(lvl,
+		"BGM prefetch buffer: %u/%u bytes filled, %u underruns",
+		stats.buffered_bytes, stats.capacity_bytes, stats.num_underruns
+	);
+}
+
 static void audio_sdl_bgm_unload(BGM *bgm) {
 	lock_audio();
 	if(mixer.players[G_BGM].channels[CHAN_BGM].stream == &bgm->stream) {
@@ -614,15 +652,16 @@ static void audio_sdl_bgm_unload(BGM *bgm) {
 	}
 	unlock_audio();
 
+	audio_sdl_bgm_report_stats(bgm);
 	astream_close(&bgm->stream);
 	free(bgm);
 }
 
-static SFXImpl *audio_sdl_sfx_load(const char *vfspath) {
-	SDL_RWops *rw = vfs_open(vfspath, VFS_MODE_READ | VFS_MODE_SEEKABLE);
+static SFXImpl *audio_sdl_sfx_decode(const char *vfspath, void *src, size_t src_size) {
+	SDL_RWops *rw = SDL_RWFromConstMem(src, src_size);
 
 	if(!rw) {
-		log_error("VFS error: %s", vfs_get_error());
+		log_sdl_error(LOG_ERROR, "SDL_RWFromConstMem");
 		return NULL;
 	}
 
@@ -663,9 +702,48 @@ static SFXImpl *audio_sdl_sfx_load(const char *vfspath) {
 		return NULL;
 	}
 
+	isnd->pcm_size = pcm_size;
+	return isnd;
+}
+
+static SFXImpl *audio_sdl_sfx_load(const char *vfspath) {
+	SDL_RWops *rw = vfs_open(vfspath, VFS_MODE_READ);
+
+	if(!rw) {
+		log_error("VFS error: %s", vfs_get_error());
+		return NULL;
+	}
+
+	char hash[SFX_CACHE_HASH_SIZE];
+	size_t src_size;
+	void *src = sfx_cache_read_source(rw, &src_size, sizeof(hash), hash);
+
+	if(!src) {
+		log_error("%s: Failed to read file", vfspath);
+		return NULL;
+	}
+
+	size_t pcm_size;
+	SFXImpl *isnd = sfx_cache_load(hash, &mixer.spec, sizeof(*isnd), &pcm_size);
+
+	if(isnd) {
+		free(src);
+		isnd->pcm_size = pcm_size;
+		log_debug("Loaded SFX from %s (cached)", vfspath);
+		return isnd;
+	}
+
+	// NOTE: the stream reads from src until it's closed
+	isnd = audio_sdl_sfx_decode(vfspath, src, src_size);
+	free(src);
+
+	if(!isnd) {
+		return NULL;
+	}
+
+	sfx_cache_store(hash, &mixer.spec, isnd->pcm_size, isnd->pcm);
 	log_debug("Loaded SFX from %s", vfspath);
 
-	isnd->pcm_size = pcm_size;
 	return isnd;
 }
 
@@ -0,0 +1,149 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "sfx_cache.h"
+
+#include "util.h"
+#include "util/cache_entry.h"
+#include "util/io.h"
+#include "rwops/rwops_sha256.h"
+
+#define CACHE_VERSION 1
+#define CACHE_MAGIC 0x58465354  // 'TSFX'
+
+enum {
+	ENTRY_PATH_SIZE = 256,
+};
+
+void *sfx_cache_read_source(SDL_RWops *rw, size_t *out_size, size_t hash_size, char hash[hash_size]) {
+	assert(hash_size >= SFX_CACHE_HASH_SIZE);
+
+	SHA256State *sha256 = sha256_new();
+	SDL_RWops *rw_hashed = SDL_RWWrapSHA256(rw, sha256, true);
+	void *buf = NULL;
+
+	if(LIKELY(rw_hashed)) {
+		buf = SDL_RWreadAll(rw_hashed, out_size, INT32_MAX);
+		SDL_RWclose(rw_hashed);
+	} else {
+		SDL_RWclose(rw);
+	}
+
+	if(UNLIKELY(!buf)) {
+		*out_size = 0;
+		sha256_free(sha256);
+		return NULL;
+	}
+
+	uint8_t raw_hash[SHA256_BLOCK_SIZE];
+	sha256_final(sha256, raw_hash, sizeof(raw_hash));
+	sha256_free(sha256);
+	hexdigest(raw_hash, sizeof(raw_hash), hash, hash_size);
+
+	assert(hash[SHA256_HEXDIGEST_SIZE - 1] == 0);
+	snprintf(&hash[SHA256_HEXDIGEST_SIZE - 1], SFX_CACHE_HASH_SIZE - SHA256_HEXDIGEST_SIZE, "-%zx", *out_size);
+
+	return buf;
+}
+
+static bool sfx_cache_make_path(const char *hash, const AudioStreamSpec *spec, size_t bufsize, char buf[bufsize]) {
+	int len = snprintf(
+		buf, bufsize,
+		"cache/sfx/%s/%04x_%u_%u",
+		hash,
+		spec->sample_format,
+		spec->channels,
+		spec->sample_rate
+	);
+
+	if(len >= bufsize) {
+		log_error("Cache entry name is too long");
+		return false;
+	}
+
+	return true;
+}
+
+void *sfx_cache_load(const char *hash, const AudioStreamSpec *spec, size_t prefix_size, size_t *out_pcm_size) {
+	char path[ENTRY_PATH_SIZE];
+	CacheEntry entry;
+
+	if(
+		!sfx_cache_make_path(hash, spec, sizeof(path), path) ||
+		!cache_entry_open_read(&entry, path, CACHE_MAGIC, CACHE_VERSION)
+	) {
+		return NULL;
+	}
+
+	SDL_RWops *s = entry.rw;
+	uint8_t *buf = NULL;
+
+	if(
+		SDL_ReadLE16(s) != spec->sample_format ||
+		SDL_ReadLE16(s) != spec->channels ||
+		SDL_ReadLE32(s) != spec->sample_rate ||
+		SDL_ReadLE32(s) != spec->frame_size
+	) {
+		log_error("%s: Bad cache entry: header mismatch", path);
+		goto fail;
+	}
+
+	uint32_t pcm_size = SDL_ReadLE32(s);
+
+	if(pcm_size == 0 || pcm_size % spec->frame_size) {
+		log_error("%s: Bad cache entry: unexpected size", path);
+		goto fail;
+	}
+
+	if(!cache_entry_expect_payload(&entry, pcm_size)) {
+		goto fail;
+	}
+
+	buf = calloc(1, prefix_size + pcm_size);
+
+	if(!cache_entry_read_payload(&entry, pcm_size, buf + prefix_size)) {
+		goto fail;
+	}
+
+	cache_entry_close(&entry);
+
+	*out_pcm_size = pcm_size;
+	return buf;
+
+fail:
+	free(buf);
+	cache_entry_close(&entry);
+	return NULL;
+}
+
+bool sfx_cache_store(const char *hash, const AudioStreamSpec *spec, size_t pcm_size, const void *pcm) {
+	char path[ENTRY_PATH_SIZE];
+	CacheEntry entry;
+
+	if(pcm_size > UINT32_MAX) {
+		return false;
+	}
+
+	if(
+		!sfx_cache_make_path(hash, spec, sizeof(path), path) ||
+		!cache_entry_open_write(&entry, path, CACHE_MAGIC, CACHE_VERSION)
+	) {
+		return false;
+	}
+
+	SDL_RWops *s = entry.rw;
+	SDL_WriteLE16(s, spec->sample_format);
+	SDL_WriteLE16(s, spec->channels);
+	SDL_WriteLE32(s, spec->sample_rate);
+	SDL_WriteLE32(s, spec->frame_size);
+	SDL_WriteLE32(s, pcm_size);
+
+	return cache_entry_finish_write(&entry, pcm_size, pcm);
+}
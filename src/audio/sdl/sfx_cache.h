@@ -0,0 +1,44 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#ifndef IGUARD_audio_sdl_sfx_cache_h
+#define IGUARD_audio_sdl_sfx_cache_h
+
+#include "taisei.h"
+
+#include "../stream/stream.h"
+#include "util/sha256.h"
+
+/*
+ * On-disk cache of crystallized (decoded and resampled) SFX PCM data.
+ * Entries are keyed by the hash of the source file and the target stream spec.
+ */
+
+// NOTE: sha256sum + hyphen + base16 64-bit file size
+#define SFX_CACHE_HASH_SIZE (SHA256_HEXDIGEST_SIZE + 17)
+
+/*
+ * Reads the whole source file from [rw] and computes its cache key. [rw] is closed.
+ * Returns the file contents, or NULL on failure.
+ */
+void *sfx_cache_read_source(SDL_RWops *rw, size_t *out_size, size_t hash_size, char hash[hash_size])
+	attr_nonnull_all attr_nodiscard;
+
+/*
+ * Looks up a cache entry. On success, returns a buffer consisting of [prefix_size] zeroed bytes
+ * followed by the PCM data, and stores the size of the latter in [out_pcm_size]. This is meant to
+ * let the caller read the samples directly into a structure with a flexible array member.
+ * Returns NULL if there is no valid entry.
+ */
+void *sfx_cache_load(const char *hash, const AudioStreamSpec *spec, size_t prefix_size, size_t *out_pcm_size)
+	attr_nonnull_all attr_nodiscard;
+
+bool sfx_cache_store(const char *hash, const AudioStreamSpec *spec, size_t pcm_size, const void *pcm)
+	attr_nonnull_all;
+
+#endif // IGUARD_audio_sdl_sfx_cache_h
@@ -11,6 +11,14 @@
 #include "player.h"
 #include "util.h"
 
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+	#define PLAYER_SIMD_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	#include <arm_neon.h>
+	#define PLAYER_SIMD_NEON
+#endif
+
 // #define SPAM(...) log_debug(__VA_ARGS__)
 #define SPAM(...) ((void)0)
 
@@ -26,7 +34,7 @@ union audio_buffer {
 	struct stereo_frame *frames;
 };
 
-bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *dst_spec) {
+bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *dst_spec, size_t chunk_size) {
 	memset(plr, 0, sizeof(*plr));
 
 	if(dst_spec->sample_format != AUDIO_F32SYS) {
@@ -41,6 +49,16 @@ bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *ds
 
 	assert(dst_spec->frame_size == sizeof(struct stereo_frame));
 
+	chunk_size -= chunk_size % dst_spec->frame_size;
+
+	if(chunk_size == 0) {
+		log_error("Audio chunk size is too small");
+		return false;
+	}
+
+	plr->staging.chunk_size = chunk_size;
+	plr->staging.mix = calloc(2, chunk_size);
+	plr->staging.pipe = plr->staging.mix + chunk_size;
 	plr->num_channels = num_channels,
 	plr->channels = calloc(sizeof(*plr->channels), num_channels);
 	plr->dst_spec = *dst_spec;
@@ -52,10 +70,11 @@ bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *ds
 		alist_append(&plr->channel_history, chan);
 	}
 
-	log_debug("Player spec: %iHz; %i chans; format=%i",
+	log_debug("Player spec: %iHz; %i chans; format=%i; chunk=%zu bytes",
 		plr->dst_spec.sample_rate,
 		plr->dst_spec.channels,
-		plr->dst_spec.sample_format
+		plr->dst_spec.sample_format,
+		plr->staging.chunk_size
 	);
 
 	return true;
@@ -81,6 +100,7 @@ void splayer_shutdown(StreamPlayer *plr) {
 	}
 
 	free(plr->channels);
+	free(plr->staging.mix);
 }
 
 static inline void splayer_stream_ended(StreamPlayer *plr, int chan) {
@@ -88,11 +108,15 @@ static inline void splayer_stream_ended(StreamPlayer *plr, int chan) {
 	splayer_halt(plr, chan);
 }
 
+static inline bool splayer_channel_is_active(StreamPlayerChannel *pchan) {
+	return !pchan->paused && pchan->stream;
+}
+
 static size_t splayer_process_channel(StreamPlayer *plr, int chan, size_t bufsize, void *buffer) {
 	AudioStreamReadFlags rflags = 0;
 	StreamPlayerChannel *pchan = plr->channels + chan;
 
-	if(pchan->paused || !pchan->stream) {
+	if(!splayer_channel_is_active(pchan)) {
 		return 0;
 	}
 
@@ -108,8 +132,10 @@ static size_t splayer_process_channel(StreamPlayer *plr, int chan, size_t bufsiz
 	if(pipe) {
 		// convert/resample
 
+		assert(bufsize <= plr->staging.chunk_size);
+		uint8_t *staging_buffer = plr->staging.pipe;
+
 		do {
-			uint8_t staging_buffer[bufsize];
 			ssize_t read = SDL_AudioStreamGet(pipe, buf, buf_end - buf);
 
 			if(UNLIKELY(read < 0)) {
@@ -123,7 +149,7 @@ static size_t splayer_process_channel(StreamPlayer *plr, int chan, size_t bufsiz
 				break;
 			}
 
-			read = astream_read_into_sdl_stream(astream, pipe, sizeof(staging_buffer), staging_buffer, rflags);
+			read = astream_read_into_sdl_stream(astream, pipe, bufsize, staging_buffer, rflags);
 
 			if(read <= 0) {
 				SDL_AudioStreamFlush(pipe);
@@ -150,68 +176,134 @@ static size_t splayer_process_channel(StreamPlayer *plr, int chan, size_t bufsiz
 	return bufsize - (buf_end - buf);
 }
 
-void splayer_process(StreamPlayer *plr, size_t bufsize, void *vbuffer) {
-	if(plr->paused) {
-		return;
+/*
+ * Mixing kernel: out[i] += in[i] * gain, on interleaved stereo frames treated as a flat array of
+ * samples. The multiply and the add are kept separate, same as in the plain C loop.
+ */
+static void mix_samples(sample_t *restrict out, const sample_t *restrict in, uint num_frames, float gain) {
+	uint num_samples = num_frames * 2;
+	uint i = 0;
+
+#if defined(PLAYER_SIMD_SSE2)
+	__m128 g = _mm_set1_ps(gain);
+
+	for(; i + 8 <= num_samples; i += 8) {
+		__m128 o0 = _mm_loadu_ps(out + i);
+		__m128 o1 = _mm_loadu_ps(out + i + 4);
+		o0 = _mm_add_ps(o0, _mm_mul_ps(_mm_loadu_ps(in + i), g));
+		o1 = _mm_add_ps(o1, _mm_mul_ps(_mm_loadu_ps(in + i + 4), g));
+		_mm_storeu_ps(out + i, o0);
+		_mm_storeu_ps(out + i + 4, o1);
+	}
+#elif defined(PLAYER_SIMD_NEON)
+	float32x4_t g = vdupq_n_f32(gain);
+
+	for(; i + 8 <= num_samples; i += 8) {
+		float32x4_t o0 = vld1q_f32(out + i);
+		float32x4_t o1 = vld1q_f32(out + i + 4);
+		o0 = vaddq_f32(o0, vmulq_f32(vld1q_f32(in + i), g));
+		o1 = vaddq_f32(o1, vmulq_f32(vld1q_f32(in + i + 4), g));
+		vst1q_f32(out + i, o0);
+		vst1q_f32(out + i + 4, o1);
+	}
+#endif
+
+	for(; i < num_samples; ++i) {
+		out[i] += in[i] * gain;
 	}
+}
 
+static void splayer_process_chunk(StreamPlayer *plr, size_t bufsize, void *vbuffer) {
 	float gain = plr->gain;
 	int num_channels = plr->num_channels;
 	union audio_buffer out_buffer = { vbuffer };
+	union audio_buffer staging_buffer = { plr->staging.mix };
 
 	for(int i = 0; i < num_channels; ++i) {
-		uint8_t staging_buffer_bytes[bufsize];
-		union audio_buffer staging_buffer = { staging_buffer_bytes };
-		size_t chan_bytes = splayer_process_channel(plr, i, sizeof(staging_buffer_bytes), staging_buffer_bytes);
+		StreamPlayerChannel *pchan = plr->channels + i;
 
-		if(chan_bytes) {
-			assert(chan_bytes <= bufsize);
-			assert(chan_bytes % sizeof(struct stereo_frame) == 0);
+		if(!splayer_channel_is_active(pchan)) {
+			continue;
+		}
 
-			StreamPlayerChannel *pchan = plr->channels + i;
-			float chan_gain = gain * pchan->gain;
-			uint num_staging_frames = chan_bytes / sizeof(struct stereo_frame);
-			uint fade_steps = pchan->fade.num_steps;
+		size_t chan_bytes = splayer_process_channel(plr, i, bufsize, staging_buffer.bytes);
 
-			if(fade_steps) {
-				float fade_step = pchan->fade.step;
-				float fade_gain = pchan->fade.gain;
+		if(!chan_bytes) {
+			continue;
+		}
 
-				if(fade_steps > num_staging_frames) {
-					fade_steps = num_staging_frames;
-				}
+		assert(chan_bytes <= bufsize);
+		assert(chan_bytes % sizeof(struct stereo_frame) == 0);
 
-				for(uint i = 0; i < fade_steps; ++i) {
-					float g = fade_gain + fade_step * i;
-					staging_buffer.frames[i].l *= g;
-					staging_buffer.frames[i].r *= g;
-				}
+		float chan_gain = gain * pchan->gain;
+		uint num_staging_frames = chan_bytes / sizeof(struct stereo_frame);
+		uint fade_steps = pchan->fade.num_steps;
+
+		if(fade_steps) {
+			float fade_step = pchan->fade.step;
+			float fade_gain = pchan->fade.gain;
 
-				if((pchan->fade.num_steps -= fade_steps) == 0) {
-					// fade finished
+			if(fade_steps > num_staging_frames) {
+				fade_steps = num_staging_frames;
+			}
+
+			for(uint f = 0; f < fade_steps; ++f) {
+				float g = fade_gain + fade_step * f;
+				staging_buffer.frames[f].l *= g;
+				staging_buffer.frames[f].r *= g;
+			}
 
-					if(pchan->fade.target == 0) {
-						splayer_stream_ended(plr, i);
-						continue;
-					}
+			if((pchan->fade.num_steps -= fade_steps) == 0) {
+				// fade finished
 
-					pchan->fade.gain = pchan->fade.target;
-					chan_gain *= pchan->fade.gain;
-				} else {
-					pchan->fade.gain += fade_step * fade_steps;
+				if(pchan->fade.target == 0) {
+					splayer_stream_ended(plr, i);
+					continue;
 				}
-			} else {
+
+				pchan->fade.gain = pchan->fade.target;
 				chan_gain *= pchan->fade.gain;
+			} else {
+				pchan->fade.gain += fade_step * fade_steps;
 			}
+		} else {
+			chan_gain *= pchan->fade.gain;
+		}
 
-			for(uint i = 0; i < num_staging_frames; ++i) {
-				out_buffer.frames[i].l += staging_buffer.frames[i].l * chan_gain;
-				out_buffer.frames[i].r += staging_buffer.frames[i].r * chan_gain;
-			}
+		// The stream still had to be advanced above, but a silent channel would only add zeros.
+		if(chan_gain != 0) {
+			mix_samples(out_buffer.samples, staging_buffer.samples, num_staging_frames, chan_gain);
 		}
 	}
 }
 
+void splayer_process(StreamPlayer *plr, size_t bufsize, void *vbuffer) {
+	if(plr->paused) {
+		return;
+	}
+
+	bool any_active = false;
+
+	for(int i = 0; i < plr->num_channels && !any_active; ++i) {
+		any_active = splayer_channel_is_active(plr->channels + i);
+	}
+
+	if(!any_active) {
+		return;
+	}
+
+	// Normally this is exactly one chunk, but the device is free to ask for more.
+	uint8_t *buf = vbuffer;
+	size_t chunk_size = plr->staging.chunk_size;
+
+	while(bufsize > 0) {
+		size_t size = bufsize < chunk_size ? bufsize : chunk_size;
+		splayer_process_chunk(plr, size, buf);
+		buf += size;
+		bufsize -= size;
+	}
+}
+
 static bool splayer_validate_channel(StreamPlayer *plr, int chan) {
 	if(chan < 0 || chan >= plr->num_channels) {
 		log_error("Bad channel %i", chan);
@@ -37,12 +37,19 @@ struct StreamPlayer {
 	StreamPlayerChannel *channels;
 	LIST_ANCHOR(StreamPlayerChannel) channel_history;
 	AudioStreamSpec dst_spec;
+	struct {
+		// Both are chunk_size bytes long and live in one allocation; owned by the audio thread.
+		uint8_t *mix;
+		uint8_t *pipe;
+		size_t chunk_size;
+	} staging;
 	float gain;
 	int num_channels;
 	bool paused;
 };
 
-bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *dst_spec) attr_nonnull_all;
+// chunk_size is the usual size of the buffer passed to splayer_process(), in bytes.
+bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *dst_spec, size_t chunk_size) attr_nonnull_all;
 void splayer_shutdown(StreamPlayer *plr) attr_nonnull_all;
 void splayer_process(StreamPlayer *plr, size_t bufsize, void *buffer) attr_nonnull_all;
 bool splayer_play(StreamPlayer *plr, int chan, AudioStream *stream, bool loop, float gain, double position, double fadein) attr_nonnull_all;
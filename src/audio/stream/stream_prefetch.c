@@ -0,0 +1,392 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#include "taisei.h"
+
+#include "stream_prefetch.h"
+#include "util.h"
+
+#define PREFETCH_CHUNK_SIZE (1 << 14)
+
+// How many chunks seeking decodes synchronously, so that playback can resume immediately.
+#define PREFETCH_PRIME_CHUNKS 2
+
+typedef struct PrefetchContext {
+	AudioStream source;
+	SDL_AudioStream *pipe;
+	uint32_t frame_size;
+	uint32_t src_rate;
+	uint32_t dst_rate;
+
+	SDL_Thread *thread;
+	SDL_sem *wakeup;
+
+	// Held by whoever is touching the source stream and the producer side of the ring.
+	SDL_mutex *mutex;
+	bool loop;
+	bool pipe_flushed;
+
+	// Single producer, single consumer. The positions are free-running byte counters;
+	// the size is a power of two, so they can wrap around safely.
+	struct {
+		uint8_t *data;
+		uint32_t size;
+		uint32_t refill_threshold;
+		SDL_atomic_t read_pos;
+		SDL_atomic_t write_pos;
+	} ring;
+
+	SDL_atomic_t eof;
+	SDL_atomic_t quit;
+	SDL_atomic_t num_underruns;
+
+	// Consumer side; also accessed by seek and tell, which don't race with reads.
+	ssize_t base_pos;
+	uint64_t frames_consumed;
+	bool underrun;
+} PrefetchContext;
+
+static uint32_t ring_available(PrefetchContext *ctx) {
+	uint32_t w = SDL_AtomicGet(&ctx->ring.write_pos);
+	uint32_t r = SDL_AtomicGet(&ctx->ring.read_pos);
+
+	// Pairs with the release barriers in ring_write() and ring_read(): whatever the other side
+	// did to the buffer before publishing its position must be visible before we touch it.
+	SDL_MemoryBarrierAcquire();
+
+	return w - r;
+}
+
+static uint32_t ring_free(PrefetchContext *ctx) {
+	return ctx->ring.size - ring_available(ctx);
+}
+
+static void ring_write(PrefetchContext *ctx, uint32_t size, const uint8_t *data) {
+	uint32_t w = SDL_AtomicGet(&ctx->ring.write_pos);
+	uint32_t ofs = w & (ctx->ring.size - 1);
+	uint32_t part = imin(size, ctx->ring.size - ofs);
+
+	assert(size <= ring_free(ctx));
+
+	memcpy(ctx->ring.data + ofs, data, part);
+	memcpy(ctx->ring.data, data + part, size - part);
+
+	// NOTE: SDL_AtomicSet is not guaranteed to be a release store (it's an acquire-only exchange
+	// with the GCC builtins), so fence explicitly to publish the data before the new position.
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&ctx->ring.write_pos, w + size);
+}
+
+static void ring_read(PrefetchContext *ctx, uint32_t size, uint8_t *data) {
+	uint32_t r = SDL_AtomicGet(&ctx->ring.read_pos);
+	uint32_t ofs = r & (ctx->ring.size - 1);
+	uint32_t part = imin(size, ctx->ring.size - ofs);
+
+	assert(size <= ring_available(ctx));
+
+	memcpy(data, ctx->ring.data + ofs, part);
+	memcpy(data + part, ctx->ring.data, size - part);
+
+	// Don't let the writer reuse the space until we're done copying out of it.
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&ctx->ring.read_pos, r + size);
+}
+
+static ssize_t prefetch_decode(PrefetchContext *ctx, size_t bufsize, uint8_t *buf) {
+	AudioStreamReadFlags flags = ctx->loop ? ASTREAM_READ_LOOP : 0;
+
+	if(!ctx->pipe) {
+		return astream_read(&ctx->source, bufsize, buf, flags);
+	}
+
+	for(;;) {
+		int read = SDL_AudioStreamGet(ctx->pipe, buf, bufsize);
+
+		if(UNLIKELY(read < 0)) {
+			log_sdl_error(LOG_ERROR, "SDL_AudioStreamGet");
+			return -1;
+		}
+
+		if(read > 0 || ctx->pipe_flushed) {
+			return read;
+		}
+
+		uint8_t staging[PREFETCH_CHUNK_SIZE];
+		ssize_t src_read = astream_read_into_sdl_stream(&ctx->source, ctx->pipe, sizeof(staging), staging, flags);
+
+		if(UNLIKELY(src_read < 0)) {
+			return -1;
+		}
+
+		if(src_read == 0) {
+			SDL_AudioStreamFlush(ctx->pipe);
+			ctx->pipe_flushed = true;
+		}
+	}
+}
+
+// Must be called with the mutex held. Returns false if nothing was added to the ring.
+static bool prefetch_fill(PrefetchContext *ctx) {
+	uint8_t buf[PREFETCH_CHUNK_SIZE];
+	uint32_t size = imin(ring_free(ctx), sizeof(buf));
+	size -= size % ctx->frame_size;
+
+	if(size == 0) {
+		return false;
+	}
+
+	ssize_t read = prefetch_decode(ctx, size, buf);
+
+	if(read <= 0) {
+		if(read < 0) {
+			log_error("Decoding failed, ending the stream early");
+		}
+
+		SDL_AtomicSet(&ctx->eof, 1);
+		return false;
+	}
+
+	assert(read <= size);
+	ring_write(ctx, read, buf);
+	return true;
+}
+
+static int prefetch_thread(void *arg) {
+	PrefetchContext *ctx = arg;
+
+	if(SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH) < 0) {
+		log_sdl_error(LOG_WARN, "SDL_SetThreadPriority");
+	}
+
+	while(!SDL_AtomicGet(&ctx->quit)) {
+		bool progress = false;
+
+		// Refill in large batches rather than topping up after every read.
+		if(!SDL_AtomicGet(&ctx->eof) && ring_free(ctx) >= ctx->ring.refill_threshold) {
+			SDL_LockMutex(ctx->mutex);
+			progress = prefetch_fill(ctx);
+			SDL_UnlockMutex(ctx->mutex);
+		}
+
+		if(!progress) {
+			SDL_SemWait(ctx->wakeup);
+		}
+	}
+
+	return 0;
+}
+
+static void prefetch_wake(PrefetchContext *ctx) {
+	if(SDL_SemValue(ctx->wakeup) == 0) {
+		SDL_SemPost(ctx->wakeup);
+	}
+}
+
+static ssize_t astream_prefetch_read(AudioStream *s, size_t bufsize, void *buffer) {
+	PrefetchContext *ctx = s->opaque;
+
+	// NOTE: Check this first, or the final chunk could be written and EOF set in between.
+	bool eof = SDL_AtomicGet(&ctx->eof);
+	uint32_t size = imin(ring_available(ctx), bufsize);
+	size -= size % ctx->frame_size;
+
+	if(size == 0) {
+		if(eof) {
+			return 0;
+		}
+
+		// Underrun: the producer fell behind. Keep the stream going with silence rather than
+		// ending it or blocking the caller.
+		if(!ctx->underrun) {
+			ctx->underrun = true;
+			SDL_AtomicIncRef(&ctx->num_underruns);
+		}
+
+		prefetch_wake(ctx);
+		size = bufsize - bufsize % ctx->frame_size;
+		memset(buffer, 0, size);
+		return size;
+	}
+
+	ring_read(ctx, size, buffer);
+	ctx->underrun = false;
+	ctx->frames_consumed += size / ctx->frame_size;
+	prefetch_wake(ctx);
+
+	return size;
+}
+
+static ssize_t astream_prefetch_tell(AudioStream *s) {
+	PrefetchContext *ctx = s->opaque;
+	uint64_t pos = ctx->base_pos + ctx->frames_consumed;
+
+	if(ctx->loop && s->length > 0 && pos >= (uint64_t)s->length) {
+		uint64_t loop_start = imax(s->loop_start, 0);
+
+		if(loop_start < (uint64_t)s->length) {
+			pos = loop_start + (pos - loop_start) % (s->length - loop_start);
+		}
+	}
+
+	return pos;
+}
+
+static ssize_t astream_prefetch_seek(AudioStream *s, size_t pos) {
+	PrefetchContext *ctx = s->opaque;
+
+	SDL_LockMutex(ctx->mutex);
+
+	ssize_t src_pos = astream_seek(&ctx->source, (uint64_t)pos * ctx->src_rate / ctx->dst_rate);
+
+	if(UNLIKELY(src_pos < 0)) {
+		SDL_UnlockMutex(ctx->mutex);
+		return -1;
+	}
+
+	if(ctx->pipe) {
+		SDL_AudioStreamClear(ctx->pipe);
+		ctx->pipe_flushed = false;
+	}
+
+	SDL_AtomicSet(&ctx->ring.read_pos, 0);
+	SDL_AtomicSet(&ctx->ring.write_pos, 0);
+	SDL_AtomicSet(&ctx->eof, 0);
+
+	ctx->base_pos = (uint64_t)src_pos * ctx->dst_rate / ctx->src_rate;
+	ctx->frames_consumed = 0;
+	ctx->underrun = false;
+
+	for(int i = 0; i < PREFETCH_PRIME_CHUNKS && prefetch_fill(ctx); ++i);
+
+	SDL_UnlockMutex(ctx->mutex);
+	prefetch_wake(ctx);
+
+	return ctx->base_pos;
+}
+
+static const char *astream_prefetch_meta(AudioStream *s, AudioStreamMetaTag tag) {
+	PrefetchContext *ctx = s->opaque;
+	return astream_get_meta_tag(&ctx->source, tag);
+}
+
+static void prefetch_free_context(PrefetchContext *ctx) {
+	if(ctx->thread) {
+		SDL_AtomicSet(&ctx->quit, 1);
+		SDL_SemPost(ctx->wakeup);
+		SDL_WaitThread(ctx->thread, NULL);
+	}
+
+	if(ctx->wakeup) {
+		SDL_DestroySemaphore(ctx->wakeup);
+	}
+
+	if(ctx->mutex) {
+		SDL_DestroyMutex(ctx->mutex);
+	}
+
+	SDL_FreeAudioStream(ctx->pipe);
+	free(ctx->ring.data);
+	free(ctx);
+}
+
+static void astream_prefetch_free(AudioStream *s) {
+	PrefetchContext *ctx = s->opaque;
+	AudioStream source = ctx->source;
+	prefetch_free_context(ctx);
+	astream_close(&source);
+}
+
+static AudioStreamProcs astream_prefetch_procs = {
+	.free = astream_prefetch_free,
+	.meta = astream_prefetch_meta,
+	.read = astream_prefetch_read,
+	.seek = astream_prefetch_seek,
+	.tell = astream_prefetch_tell,
+};
+
+static int32_t convert_offset(int32_t ofs, uint32_t src_rate, uint32_t dst_rate) {
+	if(ofs < 0) {
+		return ofs;
+	}
+
+	return (uint64_t)ofs * dst_rate / src_rate;
+}
+
+bool astream_prefetch_open(AudioStream *stream, AudioStream *source, const AudioStreamSpec *spec, double buffer_time) {
+	PrefetchContext *ctx = calloc(1, sizeof(*ctx));
+	ctx->source = *source;
+	ctx->frame_size = spec->frame_size;
+	ctx->src_rate = source->spec.sample_rate;
+	ctx->dst_rate = spec->sample_rate;
+
+	uint64_t ring_size = buffer_time * spec->sample_rate * spec->frame_size;
+	ring_size = topow2((uint64_t)imax(ring_size, PREFETCH_CHUNK_SIZE * PREFETCH_PRIME_CHUNKS));
+
+	if(ring_size > (1u << 30)) {
+		log_error("Prefetch buffer is too large");
+		goto fail;
+	}
+
+	ctx->ring.size = ring_size;
+	ctx->ring.refill_threshold = imin(ring_size / 4, PREFETCH_CHUNK_SIZE);
+	ctx->ring.data = calloc(1, ring_size);
+
+	if(!astream_spec_equals(&source->spec, spec)) {
+		if(!(ctx->pipe = astream_create_sdl_stream(source, spec))) {
+			log_sdl_error(LOG_ERROR, "SDL_NewAudioStream");
+			goto fail;
+		}
+	}
+
+	if(!(ctx->mutex = SDL_CreateMutex())) {
+		log_sdl_error(LOG_ERROR, "SDL_CreateMutex");
+		goto fail;
+	}
+
+	if(!(ctx->wakeup = SDL_CreateSemaphore(0))) {
+		log_sdl_error(LOG_ERROR, "SDL_CreateSemaphore");
+		goto fail;
+	}
+
+	if(!(ctx->thread = SDL_CreateThread(prefetch_thread, "Audio prefetch", ctx))) {
+		log_sdl_error(LOG_ERROR, "SDL_CreateThread");
+		goto fail;
+	}
+
+	*stream = (AudioStream) {
+		.procs = &astream_prefetch_procs,
+		.opaque = ctx,
+		.spec = *spec,
+		.length = convert_offset(source->length, ctx->src_rate, ctx->dst_rate),
+		.loop_start = convert_offset(source->loop_start, ctx->src_rate, ctx->dst_rate),
+	};
+
+	return true;
+
+fail:
+	prefetch_free_context(ctx);
+	return false;
+}
+
+void astream_prefetch_set_looping(AudioStream *stream, bool loop) {
+	assert(stream->procs == &astream_prefetch_procs);
+	PrefetchContext *ctx = stream->opaque;
+
+	SDL_LockMutex(ctx->mutex);
+	ctx->loop = loop;
+	SDL_UnlockMutex(ctx->mutex);
+}
+
+void astream_prefetch_get_stats(AudioStream *stream, AudioStreamPrefetchStats *stats) {
+	assert(stream->procs == &astream_prefetch_procs);
+	PrefetchContext *ctx = stream->opaque;
+
+	stats->buffered_bytes = ring_available(ctx);
+	stats->capacity_bytes = ctx->ring.size;
+	stats->num_underruns = SDL_AtomicGet(&ctx->num_underruns);
+}
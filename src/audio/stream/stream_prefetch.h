@@ -0,0 +1,52 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#ifndef IGUARD_audio_stream_stream_prefetch_h
+#define IGUARD_audio_stream_stream_prefetch_h
+
+#include "taisei.h"
+
+#include "stream.h"
+
+/*
+ * A stream that decodes and converts another stream ahead of time on a dedicated thread.
+ *
+ * Reading from it only copies samples out of a single-producer, single-consumer ring buffer,
+ * so it never blocks and never calls into the decoder. This is meant for streams that are read
+ * from the audio callback. If the producer falls behind, the reader gets silence instead.
+ *
+ * The output is always in the spec passed to astream_prefetch_open; length and loop_start are
+ * converted accordingly. Seeking blocks until the producer is idle, then refills the beginning of
+ * the buffer synchronously. Seeking, telling and changing the loop mode must not race with reads;
+ * in practice this means they must be done with the audio device locked.
+ */
+
+typedef struct AudioStreamPrefetchStats {
+	uint32_t buffered_bytes;
+	uint32_t capacity_bytes;
+	uint32_t num_underruns;
+} AudioStreamPrefetchStats;
+
+/*
+ * Takes ownership of [source] on success; it is closed together with [stream].
+ * On failure, [source] is left untouched.
+ */
+bool astream_prefetch_open(AudioStream *stream, AudioStream *source, const AudioStreamSpec *spec, double buffer_time)
+	attr_nonnull_all;
+
+/*
+ * Whether the producer should wrap around to the loop point at the end of the source.
+ * Samples that are already buffered are not affected, so this should be followed by a seek.
+ */
+void astream_prefetch_set_looping(AudioStream *stream, bool loop)
+	attr_nonnull_all;
+
+void astream_prefetch_get_stats(AudioStream *stream, AudioStreamPrefetchStats *stats)
+	attr_nonnull_all;
+
+#endif // IGUARD_audio_stream_stream_prefetch_h
@@ -0,0 +1,468 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "benchmark.h"
+#include "audio/stream/player.h"
+#include "audio/stream/stream_pcm.h"
+#include "dynarray.h"
+#include "log.h"
+#include "resource/resource.h"
+#include "stageobjects.h"
+#include "util.h"
+#include "version.h"
+
+#define NUM_POOLS (sizeof(StageObjectPools) / sizeof(ObjectPool*))
+
+typedef struct BenchSectionStats {
+	hrtime_t total;
+	hrtime_t max;
+	hrtime_t current_frame;
+} BenchSectionStats;
+
+typedef struct BenchPreloadStats {
+	hrtime_t submit;
+	hrtime_t total;
+} BenchPreloadStats;
+
+typedef struct BenchPoolStats {
+	char *tag;
+	size_t capacity;
+	size_t peak_usage;
+} BenchPoolStats;
+
+static struct {
+	char *replay_path;
+	char *report_path;
+
+	DYNAMIC_ARRAY(hrtime_t) frame_times;
+	DYNAMIC_ARRAY(BenchPreloadStats) preloads;
+	hrtime_t frame_begin_time;
+	hrtime_t first_frame_time;
+	hrtime_t last_frame_time;
+	uint num_stages;
+
+	BenchSectionStats sections[NUM_BENCH_SECTIONS];
+	BenchPoolStats pools[NUM_POOLS];
+
+	bool active;
+} bench;
+
+static const char *section_names[] = {
+	[BENCH_SECTION_COROUTINES]  = "coroutines",
+	[BENCH_SECTION_ENEMIES]     = "enemies",
+	[BENCH_SECTION_PROJECTILES] = "projectiles",
+	[BENCH_SECTION_ITEMS]       = "items",
+	[BENCH_SECTION_LASERS]      = "lasers",
+	[BENCH_SECTION_PARTICLES]   = "particles",
+};
+
+static_assert(ARRAY_SIZE(section_names) == NUM_BENCH_SECTIONS, "section_names is incomplete");
+
+void bench_init(const char *replay_path, const char *report_path) {
+	memset(&bench, 0, sizeof(bench));
+	stralloc(&bench.replay_path, replay_path);
+	stralloc(&bench.report_path, report_path);
+	dynarray_ensure_capacity(&bench.frame_times, 1 << 14);
+	bench.active = true;
+}
+
+bool bench_is_active(void) {
+	return bench.active;
+}
+
+void bench_frame_begin(void) {
+	if(!bench.active) {
+		return;
+	}
+
+	bench.frame_begin_time = time_get();
+
+	if(bench.frame_times.num_elements == 0) {
+		bench.first_frame_time = bench.frame_begin_time;
+	}
+}
+
+void bench_frame_end(void) {
+	if(!bench.active) {
+		return;
+	}
+
+	bench.last_frame_time = time_get();
+	*dynarray_append(&bench.frame_times) = bench.last_frame_time - bench.frame_begin_time;
+
+	for(uint i = 0; i < NUM_BENCH_SECTIONS; ++i) {
+		BenchSectionStats *s = bench.sections + i;
+		s->total += s->current_frame;
+		s->max = umax(s->max, s->current_frame);
+		s->current_frame = 0;
+	}
+}
+
+hrtime_t bench_section_begin(void) {
+	return bench.active ? time_get() : 0;
+}
+
+void bench_section_end(BenchSection section, hrtime_t begin_time) {
+	if(!bench.active) {
+		return;
+	}
+
+	assert((uint)section < NUM_BENCH_SECTIONS);
+	bench.sections[section].current_frame += time_get() - begin_time;
+}
+
+void bench_stage_preloaded(hrtime_t begin_time) {
+	if(!bench.active) {
+		return;
+	}
+
+	hrtime_t submit_end_time = time_get();
+	res_wait_for_pending_loads();
+	hrtime_t end_time = time_get();
+
+	*dynarray_append(&bench.preloads) = (BenchPreloadStats) {
+		.submit = submit_end_time - begin_time,
+		.total = end_time - begin_time,
+	};
+}
+
+void bench_stage_end(void) {
+	if(!bench.active) {
+		return;
+	}
+
+	ObjectPool **pools = &stage_object_pools.first;
+
+	for(uint i = 0; i < NUM_POOLS; ++i) {
+		ObjectPoolStats stats;
+		objpool_get_stats(pools[i], &stats);
+
+		BenchPoolStats *p = bench.pools + i;
+
+		if(p->tag == NULL) {
+			stralloc(&p->tag, stats.tag);
+		}
+
+		p->capacity = umax(p->capacity, stats.capacity);
+		p->peak_usage = umax(p->peak_usage, stats.peak_usage);
+	}
+
+	++bench.num_stages;
+}
+
+static double hrtime_to_us(hrtime_t t) {
+	return t / (double)(HRTIME_RESOLUTION / HRTIME_C(1000000));
+}
+
+static int hrtime_cmp(const void *a, const void *b) {
+	hrtime_t t1 = *(const hrtime_t*)a;
+	hrtime_t t2 = *(const hrtime_t*)b;
+	return (t1 > t2) - (t1 < t2);
+}
+
+static double percentile_us(const hrtime_t *sorted, uint num, double p) {
+	if(num == 0) {
+		return 0;
+	}
+
+	uint idx = (uint)(p * (num - 1) + 0.5);
+	return hrtime_to_us(sorted[idx]);
+}
+
+static void write_json_string(SDL_RWops *out, const char *str) {
+	SDL_RWprintf(out, "\"");
+
+	for(const char *c = str; *c; ++c) {
+		if(*c == '"' || *c == '\\') {
+			SDL_RWprintf(out, "\\%c", *c);
+		} else if((uchar)*c < 0x20) {
+			SDL_RWprintf(out, "\\u%04x", (uchar)*c);
+		} else {
+			SDL_RWprintf(out, "%c", *c);
+		}
+	}
+
+	SDL_RWprintf(out, "\"");
+}
+
+static void bench_write_report(SDL_RWops *out) {
+	uint num_frames = bench.frame_times.num_elements;
+	hrtime_t *sorted = num_frames ? memdup(bench.frame_times.data, sizeof(*sorted) * num_frames) : NULL;
+	hrtime_t total = 0;
+
+	if(num_frames > 0) {
+		qsort(sorted, num_frames, sizeof(*sorted), hrtime_cmp);
+	}
+
+	for(uint i = 0; i < num_frames; ++i) {
+		total += sorted[i];
+	}
+
+	SDL_RWprintf(out, "{\n");
+	SDL_RWprintf(out, "\t\"replay\": ");
+	write_json_string(out, bench.replay_path);
+	SDL_RWprintf(out, ",\n\t\"version\": ");
+	write_json_string(out, TAISEI_VERSION_FULL);
+	SDL_RWprintf(out, ",\n");
+	SDL_RWprintf(out, "\t\"stages\": %u,\n", bench.num_stages);
+	SDL_RWprintf(out, "\t\"frames\": %u,\n", num_frames);
+	SDL_RWprintf(out, "\t\"wall_time_us\": %.1f,\n", hrtime_to_us(bench.last_frame_time - bench.first_frame_time));
+
+	SDL_RWprintf(out, "\t\"logic\": {\n");
+	SDL_RWprintf(out, "\t\t\"total_us\": %.1f,\n", hrtime_to_us(total));
+	SDL_RWprintf(out, "\t\t\"mean_us\": %.3f,\n", num_frames ? hrtime_to_us(total) / num_frames : 0);
+	SDL_RWprintf(out, "\t\t\"p50_us\": %.3f,\n", percentile_us(sorted, num_frames, 0.50));
+	SDL_RWprintf(out, "\t\t\"p95_us\": %.3f,\n", percentile_us(sorted, num_frames, 0.95));
+	SDL_RWprintf(out, "\t\t\"p99_us\": %.3f,\n", percentile_us(sorted, num_frames, 0.99));
+	SDL_RWprintf(out, "\t\t\"max_us\": %.3f\n", num_frames ? hrtime_to_us(sorted[num_frames - 1]) : 0);
+	SDL_RWprintf(out, "\t},\n");
+
+	free(sorted);
+
+	SDL_RWprintf(out, "\t\"sections\": {\n");
+
+	for(uint i = 0; i < NUM_BENCH_SECTIONS; ++i) {
+		BenchSectionStats *s = bench.sections + i;
+		SDL_RWprintf(out, "\t\t\"%s\": { \"total_us\": %.1f, \"mean_us\": %.3f, \"max_us\": %.3f }%s\n",
+			section_names[i],
+			hrtime_to_us(s->total),
+			num_frames ? hrtime_to_us(s->total) / num_frames : 0,
+			hrtime_to_us(s->max),
+			i < NUM_BENCH_SECTIONS - 1 ? "," : ""
+		);
+	}
+
+	SDL_RWprintf(out, "\t},\n");
+
+	hrtime_t preload_submit = 0, preload_total = 0, preload_max = 0;
+
+	dynarray_foreach_elem(&bench.preloads, BenchPreloadStats *p, {
+		preload_submit += p->submit;
+		preload_total += p->total;
+		preload_max = umax(preload_max, p->total);
+	});
+
+	SDL_RWprintf(out, "\t\"preload\": {\n");
+	SDL_RWprintf(out, "\t\t\"submit_us\": %.1f,\n", hrtime_to_us(preload_submit));
+	SDL_RWprintf(out, "\t\t\"total_us\": %.1f,\n", hrtime_to_us(preload_total));
+	SDL_RWprintf(out, "\t\t\"max_us\": %.1f,\n", hrtime_to_us(preload_max));
+	SDL_RWprintf(out, "\t\t\"stages_us\": [");
+
+	dynarray_foreach(&bench.preloads, int i, BenchPreloadStats *p, {
+		SDL_RWprintf(out, "%s%.1f", i ? ", " : "", hrtime_to_us(p->total));
+	});
+
+	SDL_RWprintf(out, "]\n");
+	SDL_RWprintf(out, "\t},\n");
+	SDL_RWprintf(out, "\t\"objpools\": {\n");
+
+	for(uint i = 0; i < NUM_POOLS; ++i) {
+		BenchPoolStats *p = bench.pools + i;
+		SDL_RWprintf(out, "\t\t\"%s\": { \"capacity\": %zu, \"peak_usage\": %zu }%s\n",
+			p->tag ? p->tag : "unknown",
+			p->capacity,
+			p->peak_usage,
+			i < NUM_POOLS - 1 ? "," : ""
+		);
+	}
+
+	SDL_RWprintf(out, "\t},\n");
+	SDL_RWprintf(out, "\t\"frame_times_us\": [");
+
+	for(uint i = 0; i < num_frames; ++i) {
+		SDL_RWprintf(out, "%s%.3f", i ? ", " : "", hrtime_to_us(dynarray_get(&bench.frame_times, i)));
+	}
+
+	SDL_RWprintf(out, "]\n}\n");
+}
+
+static SDL_RWops *bench_open_report(const char *report_path) {
+	SDL_RWops *out;
+
+	if(report_path) {
+		out = SDL_RWFromFile(report_path, "w");
+	} else {
+		out = SDL_RWFromFP(stdout, false);
+	}
+
+	if(!out) {
+		log_sdl_error(LOG_ERROR, "SDL_RWFromFile");
+	}
+
+	return out;
+}
+
+static void bench_close_report(SDL_RWops *out, const char *report_path) {
+	SDL_RWclose(out);
+	log_info("Benchmark report written to %s", report_path ? report_path : "stdout");
+}
+
+void bench_shutdown(void) {
+	if(!bench.active) {
+		return;
+	}
+
+	SDL_RWops *out = bench_open_report(bench.report_path);
+
+	if(out) {
+		bench_write_report(out);
+		bench_close_report(out, bench.report_path);
+	}
+
+	for(uint i = 0; i < NUM_POOLS; ++i) {
+		free(bench.pools[i].tag);
+	}
+
+	dynarray_free_data(&bench.frame_times);
+	dynarray_free_data(&bench.preloads);
+	free(bench.replay_path);
+	free(bench.report_path);
+	memset(&bench, 0, sizeof(bench));
+}
+
+// Matches the defaults of the SDL audio backend.
+#define MIXER_BENCH_SAMPLE_RATE 48000
+#define MIXER_BENCH_CHUNK_FRAMES 1024
+#define MIXER_BENCH_CHUNKS 4096
+#define MIXER_BENCH_WARMUP_CHUNKS 64
+#define MIXER_BENCH_MAX_CHANNELS 64
+
+// Odd length, so that the looping streams don't wrap around in step with the chunks.
+#define MIXER_BENCH_SOURCE_FRAMES (MIXER_BENCH_SAMPLE_RATE + 7)
+
+typedef struct MixerBenchResult {
+	int num_channels;
+	hrtime_t time;
+} MixerBenchResult;
+
+static bool bench_mixer_run(
+	int num_channels, const AudioStreamSpec *spec, AudioStream *streams, float *out, hrtime_t *out_time
+) {
+	size_t chunk_size = MIXER_BENCH_CHUNK_FRAMES * spec->frame_size;
+	StreamPlayer plr;
+
+	if(!splayer_init(&plr, num_channels, spec, chunk_size)) {
+		return false;
+	}
+
+	plr.gain = 0.5;
+
+	for(int i = 0; i < num_channels; ++i) {
+		if(!splayer_play(&plr, i, streams + i, true, 1, 0, 0)) {
+			splayer_shutdown(&plr);
+			return false;
+		}
+	}
+
+	for(int i = 0; i < MIXER_BENCH_WARMUP_CHUNKS; ++i) {
+		memset(out, 0, chunk_size);
+		splayer_process(&plr, chunk_size, out);
+	}
+
+	hrtime_t begin_time = time_get();
+
+	for(int i = 0; i < MIXER_BENCH_CHUNKS; ++i) {
+		memset(out, 0, chunk_size);
+		splayer_process(&plr, chunk_size, out);
+	}
+
+	*out_time = time_get() - begin_time;
+
+	for(int i = 0; i < num_channels; ++i) {
+		splayer_halt(&plr, i);
+	}
+
+	splayer_shutdown(&plr);
+	return true;
+}
+
+int bench_mixer(const char *report_path) {
+	time_init();
+
+	AudioStreamSpec spec = astream_spec(AUDIO_F32SYS, 2, MIXER_BENCH_SAMPLE_RATE);
+	size_t source_size = MIXER_BENCH_SOURCE_FRAMES * spec.frame_size;
+	float *source = malloc(source_size);
+	float *out = malloc(MIXER_BENCH_CHUNK_FRAMES * spec.frame_size);
+	AudioStream streams[MIXER_BENCH_MAX_CHANNELS] = { 0 };
+	MixerBenchResult results[8];
+	int num_results = 0;
+	int status = 0;
+
+	// Deterministic noise; the content doesn't matter as long as it isn't silence or denormals.
+	uint32_t seed = 0x7a15e1;
+
+	for(uint i = 0; i < MIXER_BENCH_SOURCE_FRAMES * 2; ++i) {
+		seed = seed * 1664525 + 1013904223;
+		source[i] = (int32_t)seed / (float)INT32_MAX;
+	}
+
+	for(int i = 0; i < MIXER_BENCH_MAX_CHANNELS; ++i) {
+		if(!astream_pcm_open(streams + i, &spec, source_size, source, 0)) {
+			log_fatal("astream_pcm_open() failed");
+		}
+	}
+
+	for(int n = 1; n <= MIXER_BENCH_MAX_CHANNELS; n *= 2) {
+		assert(num_results < ARRAY_SIZE(results));
+		MixerBenchResult *r = results + num_results;
+		r->num_channels = n;
+
+		if(!bench_mixer_run(n, &spec, streams, out, &r->time)) {
+			log_error("Mixer benchmark failed with %i channels", n);
+			status = 1;
+			break;
+		}
+
+		log_info("%2i channels: %.1f us per chunk", n, hrtime_to_us(r->time) / MIXER_BENCH_CHUNKS);
+		++num_results;
+	}
+
+	SDL_RWops *rw = bench_open_report(report_path);
+
+	if(rw) {
+		SDL_RWprintf(rw, "{\n");
+		SDL_RWprintf(rw, "\t\"version\": ");
+		write_json_string(rw, TAISEI_VERSION_FULL);
+		SDL_RWprintf(rw, ",\n");
+		SDL_RWprintf(rw, "\t\"sample_rate\": %i,\n", MIXER_BENCH_SAMPLE_RATE);
+		SDL_RWprintf(rw, "\t\"chunk_frames\": %i,\n", MIXER_BENCH_CHUNK_FRAMES);
+		SDL_RWprintf(rw, "\t\"chunks\": %i,\n", MIXER_BENCH_CHUNKS);
+		SDL_RWprintf(rw, "\t\"mixer\": [\n");
+
+		for(int i = 0; i < num_results; ++i) {
+			MixerBenchResult *r = results + i;
+			double seconds = hrtime_to_us(r->time) / 1e6;
+			double samples = (double)MIXER_BENCH_CHUNKS * MIXER_BENCH_CHUNK_FRAMES * spec.channels * r->num_channels;
+
+			SDL_RWprintf(rw, "\t\t{ \"channels\": %i, \"chunk_us\": %.3f, \"samples_per_sec\": %.0f, \"realtime_factor\": %.1f }%s\n",
+				r->num_channels,
+				hrtime_to_us(r->time) / MIXER_BENCH_CHUNKS,
+				seconds > 0 ? samples / seconds : 0,
+				seconds > 0 ? MIXER_BENCH_CHUNKS * MIXER_BENCH_CHUNK_FRAMES / (MIXER_BENCH_SAMPLE_RATE * seconds) : 0,
+				i < num_results - 1 ? "," : ""
+			);
+		}
+
+		SDL_RWprintf(rw, "\t]\n}\n");
+		bench_close_report(rw, report_path);
+	} else {
+		status = 1;
+	}
+
+	for(int i = 0; i < MIXER_BENCH_MAX_CHANNELS; ++i) {
+		astream_close(streams + i);
+	}
+
+	free(out);
+	free(source);
+	time_shutdown();
+
+	return status;
+}
@@ -0,0 +1,61 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#ifndef IGUARD_benchmark_h
+#define IGUARD_benchmark_h
+
+#include "taisei.h"
+
+#include "hirestime.h"
+
+/*
+ * Logic frame profiler for --bench-replay. All of these are no-ops unless bench_init() was called.
+ */
+
+typedef enum BenchSection {
+	BENCH_SECTION_COROUTINES,
+	BENCH_SECTION_ENEMIES,
+	BENCH_SECTION_PROJECTILES,
+	BENCH_SECTION_ITEMS,
+	BENCH_SECTION_LASERS,
+	BENCH_SECTION_PARTICLES,
+
+	NUM_BENCH_SECTIONS,
+} BenchSection;
+
+void bench_init(const char *replay_path, const char *report_path);
+void bench_shutdown(void);
+bool bench_is_active(void);
+
+void bench_frame_begin(void);
+void bench_frame_end(void);
+
+hrtime_t bench_section_begin(void);
+void bench_section_end(BenchSection section, hrtime_t begin_time);
+
+// Records how long it took to request the stage's resources since [begin_time] (as returned by
+// bench_section_begin()), then waits for all of them to load and records that as well.
+void bench_stage_preloaded(hrtime_t begin_time);
+
+// Samples object pool usage; must be called before the stage object pools are freed.
+void bench_stage_end(void);
+
+/*
+ * Stand-alone mixer throughput benchmark for --bench-mixer: mixes synthetic streams through a
+ * StreamPlayer for increasing channel counts and writes a report into [report_path] (or stdout).
+ * Doesn't need the audio device or any other subsystem. Returns the process exit status.
+ */
+int bench_mixer(const char *report_path);
+
+#define BENCH_SECTION(section, ...) do { \
+	hrtime_t _bench_begin_time = bench_section_begin(); \
+	{ __VA_ARGS__ } \
+	bench_section_end(section, _bench_begin_time); \
+} while(0)
+
+#endif // IGUARD_benchmark_h
@@ -28,6 +28,10 @@ enum {
 	OPT_CUTSCENE_LIST,
 	OPT_FORCE_INTRO,
 	OPT_REREPLAY,
+	OPT_VERIFY_REPLAYS,
+	OPT_BENCH_REPLAY,
+	OPT_BENCH_REPORT,
+	OPT_BENCH_MIXER,
 };
 
 static void print_help(struct TsOption* opts) {
@@ -76,7 +80,11 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 	struct TsOption taisei_opts[] = {
 		{{"replay",             required_argument,  0, 'r'},            "Play a replay from %s", "FILE"},
 		{{"verify-replay",      required_argument,  0, 'R'},            "Play a replay from %s in headless mode, crash as soon as it desyncs unless --rereplay is used", "FILE"},
+		{{"verify-replays",     required_argument,  0, OPT_VERIFY_REPLAYS}, "Verify all replays in %s (a directory, or a file listing one path per line) in a single headless process", "PATH"},
 		{{"rereplay",           required_argument,  0, OPT_REREPLAY},   "Re-record replay into %s; specify input with -r or -R", "OUTFILE"},
+		{{"bench-replay",       required_argument,  0, OPT_BENCH_REPLAY}, "Play a replay from %s in headless mode as fast as possible and report timings", "FILE"},
+		{{"bench-mixer",        no_argument,        0, OPT_BENCH_MIXER}, "Measure audio mixing throughput for various channel counts and exit"},
+		{{"bench-report",       required_argument,  0, OPT_BENCH_REPORT}, "Write the --bench-replay or --bench-mixer report into %s instead of stdout", "OUTFILE"},
 #ifdef DEBUG
 		{{"play",               no_argument,        0, 'p'},            "Play a specific stage"},
 		{{"sid",                required_argument,  0, 'i'},            "Select stage by %s", "ID"},
@@ -154,6 +162,20 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 			a->type = CLI_VerifyReplay;
 			stralloc(&a->filename, optarg);
 			break;
+		case OPT_VERIFY_REPLAYS:
+			a->type = CLI_VerifyReplayBatch;
+			stralloc(&a->filename, optarg);
+			break;
+		case OPT_BENCH_REPLAY:
+			a->type = CLI_BenchReplay;
+			stralloc(&a->filename, optarg);
+			break;
+		case OPT_BENCH_MIXER:
+			a->type = CLI_BenchMixer;
+			break;
+		case OPT_BENCH_REPORT:
+			stralloc(&a->bench_report, optarg);
+			break;
 		case OPT_REREPLAY:
 			stralloc(&a->out_replay, optarg);
 			env_set("TAISEI_REPLAY_DESYNC_CHECK_FREQUENCY", 1, false);
@@ -255,6 +277,7 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 		switch(a->type) {
 			case CLI_PlayReplay:
 			case CLI_VerifyReplay:
+			case CLI_BenchReplay:
 			case CLI_SelectStage:
 				if(stageinfo_get_by_id(stageid) == NULL) {
 					log_fatal("Invalid stage id: %X", stageid);
@@ -285,6 +308,10 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 		log_fatal("--rereplay requires --replay or --verify-replay");
 	}
 
+	if(a->bench_report && a->type != CLI_BenchReplay && a->type != CLI_BenchMixer) {
+		log_fatal("--bench-report requires --bench-replay or --bench-mixer");
+	}
+
 	return 0;
 }
 
@@ -293,4 +320,6 @@ void free_cli_action(CLIAction *a) {
 	a->filename = NULL;
 	free(a->out_replay);
 	a->out_replay = NULL;
+	free(a->bench_report);
+	a->bench_report = NULL;
 }
@@ -17,6 +17,9 @@ typedef enum {
 	CLI_RunNormally = 0,
 	CLI_PlayReplay,
 	CLI_VerifyReplay,
+	CLI_VerifyReplayBatch,
+	CLI_BenchReplay,
+	CLI_BenchMixer,
 	CLI_SelectStage,
 	CLI_DumpStages,
 	CLI_DumpVFSTree,
@@ -35,6 +38,7 @@ struct CLIAction {
 	CutsceneID cutscene;
 	char *filename;
 	char *out_replay;
+	char *bench_report;
 	PlayerMode *plrmode;
 };
 
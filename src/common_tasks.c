@@ -103,7 +103,7 @@ static void randomize_hue(Color *clr, float r) {
 	*clr = *HSLA(h, s, l, a);
 }
 
-TASK(charge_sound_stopper, { SFXPlayID id; }) {
+TASK_SMALL(charge_sound_stopper, { SFXPlayID id; }) {
 	stop_sound(ARGS.id);
 }
 
@@ -23,12 +23,12 @@ DECLARE_EXTERN_TASK(
 	{ cmplx *pos; ItemCounts items; }
 );
 
-DECLARE_EXTERN_TASK(
+DECLARE_EXTERN_TASK_SMALL(
 	common_move,
 	{ cmplx *pos; MoveParams move_params; BoxedEntity ent; }
 );
 
-DECLARE_EXTERN_TASK(
+DECLARE_EXTERN_TASK_SMALL(
 	common_move_ext,
 	{ cmplx *pos; MoveParams *move_params; BoxedEntity ent; }
 );
@@ -93,7 +93,7 @@ INLINE Rect viewport_bounds(double margin) {
 
 cmplx common_wander(cmplx origin, double dist, Rect bounds);
 
-DECLARE_EXTERN_TASK(
+DECLARE_EXTERN_TASK_SMALL(
 	common_set_bitflags,
 	{
 		uint *pflags;
@@ -116,7 +116,7 @@ DECLARE_EXTERN_TASK(
 	}
 );
 
-DECLARE_EXTERN_TASK(
+DECLARE_EXTERN_TASK_SMALL(
 	common_easing_animate,
 	{ 
 		float *value;
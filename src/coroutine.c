@@ -21,14 +21,24 @@
 
 #ifdef __EMSCRIPTEN__
 	#define CO_STACK_SIZE (64 * 1024)
+	#define CO_STACK_SIZE_SMALL (16 * 1024)
 #else
 	#define CO_STACK_SIZE (256 * 1024)
+	#define CO_STACK_SIZE_SMALL (32 * 1024)
 #endif
 
+static const size_t co_stack_sizes[] = {
+	[CO_STACK_NORMAL] = CO_STACK_SIZE,
+	[CO_STACK_SMALL]  = CO_STACK_SIZE_SMALL,
+};
+
+static_assert(ARRAY_SIZE(co_stack_sizes) == NUM_CO_STACK_CLASSES, "co_stack_sizes is incomplete");
+
 // #define EVT_DEBUG
 
 #ifdef DEBUG
 	#define CO_TASK_STATS
+	#define CO_TASK_STACK_GUARD
 #endif
 
 #ifdef CO_TASK_DEBUG
@@ -65,6 +75,7 @@ struct CoTask {
 	CoTaskData *data;
 
 	uint32_t unique_id;
+	CoStackClass stack_class;
 
 #ifdef CO_TASK_DEBUG
 	char debug_label[256];
@@ -127,17 +138,25 @@ typedef struct CoTaskInitData {
 	CoTaskData *master_task_data;
 } CoTaskInitData;
 
-static LIST_ANCHOR(CoTask) task_pool;
+// One pool per stack class; tasks are only ever recycled within their own class
+static LIST_ANCHOR(CoTask) task_pools[NUM_CO_STACK_CLASSES];
 static koishi_coroutine_t *co_main;
 
+// Incremented on every task switch; see cotask_get_resume_counter()
+static uint32_t resume_counter;
+
 CoSched *_cosched_global;
 
 #ifdef CO_TASK_STATS
 static struct {
+	struct {
+		size_t num_tasks_allocated;
+		size_t num_tasks_in_use;
+		size_t peak_stack_usage;
+	} classes[NUM_CO_STACK_CLASSES];
 	size_t num_tasks_allocated;
 	size_t num_tasks_in_use;
 	size_t num_switches_this_frame;
-	size_t peak_stack_usage;
 } cotask_stats;
 
 #define STAT_VAL(name) (cotask_stats.name)
@@ -165,6 +184,78 @@ static size_t debug_event_id;
 #define TASK_DEBUG_EVENT(ev) ((void)0)
 #endif
 
+#ifdef CO_TASK_STACK_GUARD
+
+/*
+ * Small stacks are sized close to what their tasks need, and unlike the memory right below a
+ * stack, nothing traps when they overflow: the task just silently corrupts whatever was allocated
+ * next to it. To catch that in debug builds, the lowest STACK_GUARD_SIZE bytes of every small
+ * stack are filled with a known pattern, which is checked every time the task yields or returns.
+ *
+ * This doesn't catch a frame large enough to skip over the guard area entirely, but in practice
+ * a task growing slightly past its limit is the common case.
+ *
+ * As with CO_TASK_STATS_STACK, we assume that the stack grows down.
+ */
+
+#define STACK_GUARD_SIZE 512
+#define STACK_GUARD_PATTERN 0x57ac6a2du
+
+static uint32_t *get_stack_guard(CoTask *task) {
+	if(task->stack_class != CO_STACK_SMALL) {
+		return NULL;
+	}
+
+	size_t sz;
+	uint32_t *lower = koishi_get_stack(&task->ko, &sz);
+
+	// Not all koishi backends support stack inspection.
+	if(!lower || sz < STACK_GUARD_SIZE * 2) {
+		return NULL;
+	}
+
+	ASAN_UNPOISON_MEMORY_REGION(lower, STACK_GUARD_SIZE);
+	return lower;
+}
+
+static void setup_stack_guard(CoTask *task) {
+	uint32_t *guard = get_stack_guard(task);
+
+	if(!guard) {
+		return;
+	}
+
+	for(uint i = 0; i < STACK_GUARD_SIZE / sizeof(*guard); ++i) {
+		guard[i] = STACK_GUARD_PATTERN;
+	}
+}
+
+static void check_stack_guard(CoTask *task) {
+	uint32_t *guard = get_stack_guard(task);
+
+	if(!guard) {
+		return;
+	}
+
+	for(uint i = 0; i < STACK_GUARD_SIZE / sizeof(*guard); ++i) {
+		if(UNLIKELY(guard[i] != STACK_GUARD_PATTERN)) {
+			log_fatal(
+				"Task %p overflowed its small stack (%zu bytes); declare it with a normal stack instead",
+				(void*)task, co_stack_sizes[task->stack_class]
+			);
+		}
+	}
+}
+
+#else // CO_TASK_STACK_GUARD
+
+#define STACK_GUARD_SIZE 0
+
+static void setup_stack_guard(CoTask *task) { }
+static void check_stack_guard(CoTask *task) { }
+
+#endif // CO_TASK_STACK_GUARD
+
 #ifdef CO_TASK_STATS_STACK
 
 /*
@@ -186,7 +277,7 @@ static size_t debug_event_id;
  * overwrite that with canaries. fcontext requires this.
  */
 #define STACK_BUFFER_UPPER 64
-#define STACK_BUFFER_LOWER 0
+#define STACK_BUFFER_LOWER STACK_GUARD_SIZE
 
 // for splitmix32
 #include "random.h"
@@ -275,15 +366,16 @@ static void estimate_stack_usage(CoTask *task) {
 	size_t usage = (uintptr_t)(first_segment + num_segments - p_canary) * sizeof(canary) + STACK_BUFFER_UPPER;
 	double percentage = usage / (double)real_stack_size;
 
-	if(usage > STAT_VAL(peak_stack_usage)) {
+	if(usage > STAT_VAL(classes[task->stack_class].peak_stack_usage)) {
 		TASK_DEBUG(">>> %s <<<", task->debug_label);
-		log_debug("New peak stack usage: %zu out of %zu (%.02f%%); recommended CO_STACK_SIZE >= %zu",
+		log_debug("New peak stack usage for class %i: %zu out of %zu (%.02f%%); recommended stack size >= %zu",
+			task->stack_class,
 			usage,
 			real_stack_size,
 			percentage * 100,
 			(size_t)(topow2_u64(usage) * 2)
 		);
-		STAT_VAL_SET(peak_stack_usage, usage);
+		STAT_VAL_SET(classes[task->stack_class].peak_stack_usage, usage);
 	}
 }
 
@@ -326,11 +418,14 @@ static CoTask *cotask_unbox_notnull(BoxedTask box) {
 	return NULL;
 }
 
-static CoTask *cotask_new_internal(koishi_entrypoint_t entry_point) {
+static CoTask *cotask_new_internal(koishi_entrypoint_t entry_point, CoStackClass stack_class) {
+	assert((uint)stack_class < NUM_CO_STACK_CLASSES);
+
 	CoTask *task;
 	STAT_VAL_ADD(num_tasks_in_use, 1);
+	STAT_VAL_ADD(classes[stack_class].num_tasks_in_use, 1);
 
-	if((task = alist_pop(&task_pool))) {
+	if((task = alist_pop(&task_pools[stack_class]))) {
 		koishi_recycle(&task->ko, entry_point);
 		TASK_DEBUG(
 			"Recycled task %p, entry=%p (%zu tasks allocated / %zu in use)",
@@ -339,8 +434,10 @@ static CoTask *cotask_new_internal(koishi_entrypoint_t entry_point) {
 		);
 	} else {
 		task = calloc(1, sizeof(*task));
-		koishi_init(&task->ko, CO_STACK_SIZE, entry_point);
+		task->stack_class = stack_class;
+		koishi_init(&task->ko, co_stack_sizes[stack_class], entry_point);
 		STAT_VAL_ADD(num_tasks_allocated, 1);
+		STAT_VAL_ADD(classes[stack_class].num_tasks_allocated, 1);
 		TASK_DEBUG(
 			"Created new task %p, entry=%p (%zu tasks allocated / %zu in use)",
 			(void*)task, *(void**)&entry_point,
@@ -351,6 +448,7 @@ static CoTask *cotask_new_internal(koishi_entrypoint_t entry_point) {
 	static uint32_t unique_counter = 0;
 	task->unique_id = ++unique_counter;
 	setup_stack(task);
+	setup_stack_guard(task);
 	assert(unique_counter != 0);
 
 	task->data = NULL;
@@ -366,7 +464,9 @@ static void *cotask_resume_internal(CoTask *task, void *arg) {
 	TASK_DEBUG_EVENT(ev);
 	TASK_DEBUG("[%zu] Resuming task %s", ev, task->debug_label);
 	STAT_VAL_ADD(num_switches_this_frame, 1);
+	++resume_counter;
 	arg = koishi_resume(&task->ko, arg);
+	check_stack_guard(task);
 	TASK_DEBUG("[%zu] koishi_resume returned (%s)", ev, task->debug_label);
 	return arg;
 }
@@ -528,12 +628,14 @@ void cotask_free(CoTask *task) {
 
 	assert(task->data == NULL);
 
+	check_stack_guard(task);
 	estimate_stack_usage(task);
 
 	task->unique_id = 0;
-	alist_push(&task_pool, task);
+	alist_push(&task_pools[task->stack_class], task);
 
 	STAT_VAL_ADD(num_tasks_in_use, -1);
+	STAT_VAL_ADD(classes[task->stack_class].num_tasks_in_use, -1);
 
 	TASK_DEBUG(
 		"Released task %s (%zu tasks allocated / %zu in use)",
@@ -542,6 +644,10 @@ void cotask_free(CoTask *task) {
 	);
 }
 
+uint32_t cotask_get_resume_counter(void) {
+	return resume_counter;
+}
+
 CoTask *cotask_active(void) {
 	koishi_coroutine_t *co = koishi_active();
 	assert(co != co_main);
@@ -594,7 +700,7 @@ static void cotask_force_cancel(CoTask *task) {
 	// CoTaskData, since we don't need any of the 'advanced' features for this.
 	// This also means we don't need to cotask_finalize it.
 
-	CoTask *cancel_task = cotask_new_internal(cotask_cancel_in_safe_context);
+	CoTask *cancel_task = cotask_new_internal(cotask_cancel_in_safe_context, CO_STACK_NORMAL);
 
 	// This is basically just koishi_resume + some logging when built with CO_TASK_DEBUG.
 	// We can't use normal cotask_resume here, since we don't have CoTaskData.
@@ -993,8 +1099,8 @@ void cosched_init(CoSched *sched) {
 	memset(sched, 0, sizeof(*sched));
 }
 
-CoTask *_cosched_new_task(CoSched *sched, CoTaskFunc func, void *arg, size_t arg_size, bool is_subtask, CoTaskDebugInfo debug) {
-	CoTask *task = cotask_new_internal(cotask_entry);
+CoTask *_cosched_new_task(CoSched *sched, CoTaskFunc func, void *arg, size_t arg_size, CoStackClass stack_class, bool is_subtask, CoTaskDebugInfo debug) {
+	CoTask *task = cotask_new_internal(cotask_entry, stack_class);
 
 #ifdef CO_TASK_DEBUG
 	snprintf(task->debug_label, sizeof(task->debug_label), "#%i <%p> %s (%s:%i:%s)", task->unique_id, (void*)task, debug.label, debug.debug_info.file, debug.debug_info.line, debug.debug_info.func);
@@ -1132,9 +1238,11 @@ void coroutines_init(void) {
 }
 
 void coroutines_shutdown(void) {
-	for(CoTask *task; (task = alist_pop(&task_pool));) {
-		koishi_deinit(&task->ko);
-		free(task);
+	for(uint i = 0; i < NUM_CO_STACK_CLASSES; ++i) {
+		for(CoTask *task; (task = alist_pop(&task_pools[i]));) {
+			koishi_deinit(&task->ko);
+			free(task);
+		}
 	}
 }
 
@@ -1163,20 +1271,36 @@ void coroutines_draw_stats(void) {
 
 	tp.pos.y += ls;
 
+	static const char *class_names[] = {
+		[CO_STACK_NORMAL] = "Tasks",
+		[CO_STACK_SMALL]  = "Small tasks",
+	};
+
+	static_assert(ARRAY_SIZE(class_names) == NUM_CO_STACK_CLASSES, "class_names is incomplete");
+
+	for(uint i = 0; i < NUM_CO_STACK_CLASSES; ++i) {
+		if(i > 0) {
+			tp.pos.y += ls;
+		}
+
 #ifdef CO_TASK_STATS_STACK
-	snprintf(buf, sizeof(buf), "Peak stack: %zukb    Tasks: %4zu / %4zu ",
-		STAT_VAL(peak_stack_usage) / 1024,
-		STAT_VAL(num_tasks_in_use),
-		STAT_VAL(num_tasks_allocated)
-	);
+		snprintf(buf, sizeof(buf), "Peak stack: %zukb / %zukb    %s: %4zu / %4zu ",
+			STAT_VAL(classes[i].peak_stack_usage) / 1024,
+			co_stack_sizes[i] / 1024,
+			class_names[i],
+			STAT_VAL(classes[i].num_tasks_in_use),
+			STAT_VAL(classes[i].num_tasks_allocated)
+		);
 #else
-	snprintf(buf, sizeof(buf), "Tasks: %4zu / %4zu ",
-		STAT_VAL(num_tasks_in_use),
-		STAT_VAL(num_tasks_allocated)
-	);
+		snprintf(buf, sizeof(buf), "%s: %4zu / %4zu ",
+			class_names[i],
+			STAT_VAL(classes[i].num_tasks_in_use),
+			STAT_VAL(classes[i].num_tasks_allocated)
+		);
 #endif
 
-	text_draw(buf, &tp);
+		text_draw(buf, &tp);
+	}
 
 	tp.pos.y += ls;
 	snprintf(buf, sizeof(buf), "Switches/frame: %4zu ", STAT_VAL(num_switches_this_frame));
@@ -33,6 +33,20 @@ typedef enum CoStatus {
 	CO_STATUS_DEAD      = KOISHI_DEAD,
 } CoStatus;
 
+/*
+ * Tasks are allocated from separate pools depending on their stack size class. Most tasks run
+ * arbitrary stage code and need the full stack, but trivial helpers (movers, animators, etc.)
+ * spawned in large numbers can be declared with the _SMALL task macros to save memory.
+ *
+ * Tasks invoked through an indirect handle always get a normal stack.
+ */
+typedef enum CoStackClass {
+	CO_STACK_NORMAL,
+	CO_STACK_SMALL,
+
+	NUM_CO_STACK_CLASSES,
+} CoStackClass;
+
 typedef enum CoEventStatus {
 	CO_EVENT_PENDING,
 	CO_EVENT_SIGNALED,
@@ -106,6 +120,7 @@ CoWaitResult cotask_wait_event_once(CoEvent *evt);
 int cotask_wait_subtasks(void);
 CoStatus cotask_status(CoTask *task);
 CoTask *cotask_active(void);
+uint32_t cotask_get_resume_counter(void);
 EntityInterface *cotask_bind_to_entity(CoTask *task, EntityInterface *ent) attr_returns_nonnull;
 CoTaskEvents *cotask_get_events(CoTask *task);
 void *cotask_malloc(CoTask *task, size_t size) attr_returns_allocated attr_malloc attr_alloc_size(2);
@@ -129,11 +144,11 @@ void _coevent_array_action(uint num, CoEvent *events, void (*func)(CoEvent*));
 #define COEVENT_CANCEL_ARRAY(array) COEVENT_ARRAY_ACTION(coevent_cancel, array)
 
 void cosched_init(CoSched *sched);
-CoTask *_cosched_new_task(CoSched *sched, CoTaskFunc func, void *arg, size_t arg_size, bool is_subtask, CoTaskDebugInfo debug);  // creates and runs the task, schedules it for resume on cosched_run_tasks if it's still alive
-#define cosched_new_task(sched, func, arg, arg_size, debug_label) \
-	_cosched_new_task(sched, func, arg, arg_size, false, COTASK_DEBUG_INFO(debug_label))
-#define cosched_new_subtask(sched, func, arg, arg_size, debug_label) \
-	_cosched_new_task(sched, func, arg, arg_size, true, COTASK_DEBUG_INFO(debug_label))
+CoTask *_cosched_new_task(CoSched *sched, CoTaskFunc func, void *arg, size_t arg_size, CoStackClass stack_class, bool is_subtask, CoTaskDebugInfo debug);  // creates and runs the task, schedules it for resume on cosched_run_tasks if it's still alive
+#define cosched_new_task(sched, func, arg, arg_size, stack_class, debug_label) \
+	_cosched_new_task(sched, func, arg, arg_size, stack_class, false, COTASK_DEBUG_INFO(debug_label))
+#define cosched_new_subtask(sched, func, arg, arg_size, stack_class, debug_label) \
+	_cosched_new_task(sched, func, arg, arg_size, stack_class, true, COTASK_DEBUG_INFO(debug_label))
 uint cosched_run_tasks(CoSched *sched);  // returns number of tasks ran
 void cosched_finish(CoSched *sched);
 
@@ -201,9 +216,13 @@ INLINE void cosched_set_invoke_target(CoSched *sched) { _cosched_global = sched;
 	/* user-defined task body */ \
 	static void COTASK_##name(TASK_ARGS_TYPE(name) *_cotask_args) /* require semicolon */
 
-#define TASK_COMMON_DECLARATIONS(name, argstype, handletype, linkage) \
+#define TASK_STACK_CLASS(name) COTASKSTACK_##name
+
+#define TASK_COMMON_DECLARATIONS(name, argstype, handletype, linkage, stack_class) \
 	/* produce warning if the task is never used */ \
 	linkage char COTASK_UNUSED_CHECK_##name; \
+	/* stack size class of the task's coroutine */ \
+	enum { TASK_STACK_CLASS(name) = (stack_class) }; \
 	/* type of indirect handle to a compatible task */ \
 	typedef handletype TASK_INDIRECT_TYPE_ALIAS(name); \
 	/* user-defined type of args struct */ \
@@ -274,8 +293,8 @@ INLINE void cosched_set_invoke_target(CoSched *sched) { _cosched_global = sched;
 	linkage void COTASK_##name(TASK_ARGS_TYPE(name) *_cotask_args)
 
 
-#define DECLARE_TASK_EXPLICIT(name, argstype, handletype, linkage) \
-	TASK_COMMON_DECLARATIONS(name, argstype, handletype, linkage) /* require semicolon */
+#define DECLARE_TASK_EXPLICIT(name, argstype, handletype, linkage, stack_class) \
+	TASK_COMMON_DECLARATIONS(name, argstype, handletype, linkage, stack_class) /* require semicolon */
 
 #define DEFINE_TASK_EXPLICIT(name, linkage) \
 	TASK_COMMON_PRIVATE_DECLARATIONS(name); \
@@ -286,11 +305,15 @@ INLINE void cosched_set_invoke_target(CoSched *sched) { _cosched_global = sched;
 
 /* declare a task with static linkage (needs to be defined later) */
 #define DECLARE_TASK(name, argstruct) \
-	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(argstruct), void, static) /* require semicolon */
+	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(argstruct), void, static, CO_STACK_NORMAL) /* require semicolon */
+
+/* like DECLARE_TASK, but the task runs on a small stack; only use this for trivial tasks */
+#define DECLARE_TASK_SMALL(name, argstruct) \
+	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(argstruct), void, static, CO_STACK_SMALL) /* require semicolon */
 
 /* declare a task with static linkage that conforms to a common interface (needs to be defined later) */
 #define DECLARE_TASK_WITH_INTERFACE(name, iface) \
-	DECLARE_TASK_EXPLICIT(name, TASK_IFACE_ARGS_TYPE(iface), TASK_INDIRECT_TYPE(iface), static) /* require semicolon */
+	DECLARE_TASK_EXPLICIT(name, TASK_IFACE_ARGS_TYPE(iface), TASK_INDIRECT_TYPE(iface), static, CO_STACK_NORMAL) /* require semicolon */
 
 /* define a task with static linkage (needs to be declared first) */
 #define DEFINE_TASK(name) \
@@ -301,6 +324,11 @@ INLINE void cosched_set_invoke_target(CoSched *sched) { _cosched_global = sched;
 	DECLARE_TASK(name, argstruct); \
 	DEFINE_TASK(name)
 
+/* declare and define a task with static linkage that runs on a small stack */
+#define TASK_SMALL(name, argstruct) \
+	DECLARE_TASK_SMALL(name, argstruct); \
+	DEFINE_TASK(name)
+
 /* declare and define a task with static linkage that conforms to a common interface */
 #define TASK_WITH_INTERFACE(name, iface) \
 	DECLARE_TASK_WITH_INTERFACE(name, iface); \
@@ -309,11 +337,15 @@ INLINE void cosched_set_invoke_target(CoSched *sched) { _cosched_global = sched;
 
 /* declare a task with extern linkage (needs to be defined later) */
 #define DECLARE_EXTERN_TASK(name, argstruct) \
-	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(argstruct), void, extern) /* require semicolon */
+	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(argstruct), void, extern, CO_STACK_NORMAL) /* require semicolon */
+
+/* declare a task with extern linkage that runs on a small stack (needs to be defined later) */
+#define DECLARE_EXTERN_TASK_SMALL(name, argstruct) \
+	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(argstruct), void, extern, CO_STACK_SMALL) /* require semicolon */
 
 /* declare a task with extern linkage that conforms to a common interface (needs to be defined later) */
 #define DECLARE_EXTERN_TASK_WITH_INTERFACE(name, iface) \
-	DECLARE_TASK_EXPLICIT(name, TASK_IFACE_ARGS_TYPE(iface), TASK_INDIRECT_TYPE(iface), extern) /* require semicolon */
+	DECLARE_TASK_EXPLICIT(name, TASK_IFACE_ARGS_TYPE(iface), TASK_INDIRECT_TYPE(iface), extern, CO_STACK_NORMAL) /* require semicolon */
 
 /* define a task with extern linkage (needs to be declared first) */
 #define DEFINE_EXTERN_TASK(name) \
@@ -352,6 +384,7 @@ INLINE void cosched_set_invoke_target(CoSched *sched) { _cosched_global = sched;
 		COTASKTHUNK_##name, \
 		(&(TASK_ARGS_TYPE(name)) { __VA_ARGS__ }), \
 		sizeof(TASK_ARGS_TYPE(name)), \
+		TASK_STACK_CLASS(name), \
 		#name \
 	) \
 )
@@ -384,6 +417,7 @@ INLINE void cosched_set_invoke_target(CoSched *sched) { _cosched_global = sched;
 			.delay = (_delay) \
 		}), \
 		sizeof(TASK_ARGSDELAY(name)), \
+		TASK_STACK_CLASS(name), \
 		#name \
 	) \
 )
@@ -423,6 +457,7 @@ INLINE void cosched_set_invoke_target(CoSched *sched) { _cosched_global = sched;
 			.unconditional = is_unconditional \
 		}), \
 		sizeof(TASK_ARGSCOND(name)), \
+		TASK_STACK_CLASS(name), \
 		#name \
 	) \
 )
@@ -443,7 +478,7 @@ INLINE void cosched_set_invoke_target(CoSched *sched) { _cosched_global = sched;
 #define CANCEL_TASK_WHEN(_event, _task) INVOKE_TASK_WHEN(_event, _cancel_task_helper, _task)
 #define CANCEL_TASK_AFTER(_event, _task) INVOKE_TASK_AFTER(_event, _cancel_task_helper, _task)
 
-DECLARE_EXTERN_TASK(_cancel_task_helper, { BoxedTask task; });
+DECLARE_EXTERN_TASK_SMALL(_cancel_task_helper, { BoxedTask task; });
 
 #define CANCEL_TASK(boxed_task) cotask_cancel(cotask_unbox(boxed_task))
 
@@ -461,6 +496,7 @@ DECLARE_EXTERN_TASK(_cancel_task_helper, { BoxedTask task; });
 		taskhandle._cotask_##iface##_thunk, \
 		(&(TASK_IFACE_ARGS_TYPE(iface)) { __VA_ARGS__ }), \
 		sizeof(TASK_IFACE_ARGS_TYPE(iface)), \
+		CO_STACK_NORMAL, \
 		"<indirect:"#iface">" \
 	) \
 )
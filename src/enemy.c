@@ -15,6 +15,7 @@
 #include "list.h"
 #include "aniplayer.h"
 #include "stageobjects.h"
+#include "enemy_grid.h"
 #include "util/glm.h"
 #include "entity.h"
 
@@ -101,6 +102,7 @@ Enemy *create_enemy_p(EnemyList *enemies, cmplx pos, float hp, EnemyVisualRule v
 	// FIXME: some code relies on the insertion logic (which?)
 	Enemy *e = alist_insert(enemies, enemies->first, (Enemy*)objpool_acquire(stage_object_pools.enemies));
 	// Enemy *e = alist_append(enemies, (Enemy*)objpool_acquire(stage_object_pools.enemies));
+	enemy_grid_invalidate();
 	e->moving = false;
 	e->dir = 0;
 
@@ -197,6 +199,7 @@ static void *_delete_enemy(ListAnchor *enemies, List* enemy, void *arg) {
 	enemy_call_logic_rule(e, EVENT_DEATH);
 	ent_unregister(&e->ent);
 	objpool_release(stage_object_pools.enemies, alist_unlink(enemies, enemy));
+	enemy_grid_invalidate();
 
 	return NULL;
 }
@@ -0,0 +1,172 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "enemy_grid.h"
+#include "global.h"
+
+#define GRID_CELL_SIZE 32
+#define GRID_CELLS_X ((VIEWPORT_W + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE)
+#define GRID_CELLS_Y ((VIEWPORT_H + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE)
+#define GRID_NUM_CELLS (GRID_CELLS_X * GRID_CELLS_Y)
+
+// Extra margin around hit circles, so that rounding never makes us miss a cell.
+#define GRID_PADDING 1.0
+
+static struct {
+	EnemyList *enemies;
+
+	// Enemies bucketed by cell; cell i occupies [cell_offsets[i], cell_offsets[i+1]).
+	// Within a cell, enemies are stored in list order.
+	DYNAMIC_ARRAY(Enemy*) entries;
+	uint32_t cell_offsets[GRID_NUM_CELLS + 1];
+
+	uint32_t resume_counter;
+	bool active;
+	bool dirty;
+} grid;
+
+static inline bool enemy_hit_test(Enemy *e, cmplx pos) {
+	return !(e->flags & EFLAG_NO_HIT) && cabs(e->pos - pos) < e->hit_radius;
+}
+
+static inline int grid_coord(double v, int max) {
+	double c = floor(v / GRID_CELL_SIZE);
+
+	// Also catches NaN
+	if(!(c >= 0)) {
+		return 0;
+	}
+
+	if(c > max) {
+		return max;
+	}
+
+	return (int)c;
+}
+
+static bool enemy_grid_cell_range(Enemy *e, IntRect *r) {
+	if(e->flags & EFLAG_NO_HIT) {
+		return false;
+	}
+
+	double x = creal(e->pos);
+	double y = cimag(e->pos);
+	double rad = e->hit_radius;
+
+	// Such enemies can never be hit; see enemy_hit_test()
+	if(!(rad > 0) || !isfinite(x) || !isfinite(y)) {
+		return false;
+	}
+
+	rad += GRID_PADDING;
+
+	int x0 = grid_coord(x - rad, GRID_CELLS_X - 1);
+	int y0 = grid_coord(y - rad, GRID_CELLS_Y - 1);
+	int x1 = grid_coord(x + rad, GRID_CELLS_X - 1);
+	int y1 = grid_coord(y + rad, GRID_CELLS_Y - 1);
+
+	*r = (IntRect) { x0, y0, x1 - x0 + 1, y1 - y0 + 1 };
+	return true;
+}
+
+#define FOR_EACH_CELL(r, cell, ...) do { \
+	for(int _y = (r).y; _y < (r).y + (r).h; ++_y) { \
+		for(int _x = (r).x; _x < (r).x + (r).w; ++_x) { \
+			int cell = _y * GRID_CELLS_X + _x; \
+			__VA_ARGS__ \
+		} \
+	} \
+} while(0)
+
+static void enemy_grid_rebuild(void) {
+	uint32_t *offsets = grid.cell_offsets;
+	memset(offsets, 0, sizeof(grid.cell_offsets));
+
+	IntRect r;
+
+	for(Enemy *e = grid.enemies->first; e; e = e->next) {
+		if(enemy_grid_cell_range(e, &r)) {
+			FOR_EACH_CELL(r, cell, {
+				++offsets[cell + 1];
+			});
+		}
+	}
+
+	for(int i = 1; i <= GRID_NUM_CELLS; ++i) {
+		offsets[i] += offsets[i - 1];
+	}
+
+	uint32_t num_entries = offsets[GRID_NUM_CELLS];
+	dynarray_ensure_capacity(&grid.entries, num_entries);
+	grid.entries.num_elements = num_entries;
+
+	uint32_t cursor[GRID_NUM_CELLS];
+	memcpy(cursor, offsets, sizeof(cursor));
+
+	for(Enemy *e = grid.enemies->first; e; e = e->next) {
+		if(enemy_grid_cell_range(e, &r)) {
+			FOR_EACH_CELL(r, cell, {
+				grid.entries.data[cursor[cell]++] = e;
+			});
+		}
+	}
+
+	grid.resume_counter = cotask_get_resume_counter();
+	grid.dirty = false;
+}
+
+void enemy_grid_begin(EnemyList *enemies) {
+	grid.enemies = enemies;
+	grid.active = true;
+	enemy_grid_rebuild();
+}
+
+void enemy_grid_end(void) {
+	grid.active = false;
+	grid.enemies = NULL;
+}
+
+void enemy_grid_invalidate(void) {
+	grid.dirty = true;
+}
+
+void enemy_grid_shutdown(void) {
+	enemy_grid_end();
+	dynarray_free_data(&grid.entries);
+}
+
+Enemy *enemy_grid_find_hit(EnemyList *enemies, cmplx pos) {
+	if(!grid.active || grid.enemies != enemies) {
+		for(Enemy *e = enemies->first; e; e = e->next) {
+			if(enemy_hit_test(e, pos)) {
+				return e;
+			}
+		}
+
+		return NULL;
+	}
+
+	if(grid.dirty || grid.resume_counter != cotask_get_resume_counter()) {
+		enemy_grid_rebuild();
+	}
+
+	int cell = grid_coord(cimag(pos), GRID_CELLS_Y - 1) * GRID_CELLS_X + grid_coord(creal(pos), GRID_CELLS_X - 1);
+	uint32_t end = grid.cell_offsets[cell + 1];
+
+	for(uint32_t i = grid.cell_offsets[cell]; i < end; ++i) {
+		Enemy *e = grid.entries.data[i];
+
+		if(enemy_hit_test(e, pos)) {
+			return e;
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,35 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#ifndef IGUARD_enemy_grid_h
+#define IGUARD_enemy_grid_h
+
+#include "taisei.h"
+
+#include "enemy.h"
+
+/*
+ * A uniform grid over the viewport that buckets enemies by their hit circles.
+ * It's built once per logic frame before player projectiles are processed,
+ * and lets them find the enemy they collide with without scanning the whole
+ * enemy list.
+ *
+ * Queries are guaranteed to return exactly what a linear scan of the list
+ * would: the first enemy in list order that is hit. If the grid may be stale
+ * (any task code or legacy rule ran, or an enemy was spawned or removed since
+ * it was built), it is transparently rebuilt on the next query.
+ */
+
+void enemy_grid_begin(EnemyList *enemies) attr_nonnull_all;
+void enemy_grid_end(void);
+void enemy_grid_invalidate(void);
+void enemy_grid_shutdown(void);
+
+Enemy *enemy_grid_find_hit(EnemyList *enemies, cmplx pos) attr_nonnull_all;
+
+#endif // IGUARD_enemy_grid_h
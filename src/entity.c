@@ -23,13 +23,40 @@ struct EntityDrawHook {
 	void *arg;
 };
 
+typedef struct EntityDrawPassHook EntityDrawPassHook;
+typedef LIST_ANCHOR(EntityDrawPassHook) EntityDrawPassHookList;
+
+struct EntityDrawPassHook {
+	LIST_INTERFACE(EntityDrawPassHook);
+	EntityDrawPassCallback begin;
+	EntityDrawPassCallback end;
+	void *arg;
+};
+
+/*
+ * Entities are kept in draw order, i.e. sorted by (draw_layer, spawn_id), so that most frames
+ * don't need to sort anything. Each entry remembers the layer it was sorted by; entities that
+ * changed their draw_layer since are pulled out and re-inserted at draw time.
+ */
+typedef struct EntityDrawOrderEntry {
+	EntityInterface *ent;  // NULL if unregistered since the last ent_draw()
+	drawlayer_t layer;
+} EntityDrawOrderEntry;
+
 static struct {
-	DYNAMIC_ARRAY(EntityInterface*) registered;
+	// [0, num_sorted) is sorted; newly registered entities are appended after that.
+	DYNAMIC_ARRAY(EntityDrawOrderEntry) registered;
+	DYNAMIC_ARRAY(EntityDrawOrderEntry) reinsert_buffer;
+	dynarray_size_t num_sorted;
+	dynarray_size_t num_unregistered;
 	uint32_t total_spawns;
+	bool drawing;
 
 	struct {
 		EntityDrawHookList pre_draw;
 		EntityDrawHookList post_draw;
+		EntityDrawPassHookList type_passes[_ENT_TYPE_ENUM_END];
+		EntityDrawPassHookList layer_passes[NUM_LAYER_IDS];
 	} hooks;
 } entities;
 
@@ -59,93 +86,280 @@ static void call_hooks(EntityDrawHookList *list, EntityInterface *ent) {
 	}
 }
 
+static void add_pass_hook(EntityDrawPassHookList *list, EntityDrawPassCallback begin, EntityDrawPassCallback end, void *arg) {
+	assert(begin || end);
+
+	EntityDrawPassHook *hook = calloc(1, sizeof(*hook));
+	hook->begin = begin;
+	hook->end = end;
+	hook->arg = arg;
+
+	alist_append(list, hook);
+}
+
+static void remove_pass_hook(EntityDrawPassHookList *list, EntityDrawPassCallback begin, EntityDrawPassCallback end) {
+	for(EntityDrawPassHook *hook = list->first; hook; hook = hook->next) {
+		if(hook->begin == begin && hook->end == end) {
+			alist_unlink(list, hook);
+			free(hook);
+			return;
+		}
+	}
+
+	UNREACHABLE;
+}
+
+static void call_pass_begin_hooks(EntityDrawPassHookList *list) {
+	for(EntityDrawPassHook *hook = list->first; hook; hook = hook->next) {
+		if(hook->begin) {
+			hook->begin(hook->arg);
+		}
+	}
+}
+
+static void call_pass_end_hooks(EntityDrawPassHookList *list) {
+	for(EntityDrawPassHook *hook = list->first; hook; hook = hook->next) {
+		if(hook->end) {
+			hook->end(hook->arg);
+		}
+	}
+}
+
 void ent_init(void) {
 	memset(&entities, 0, sizeof(entities));
 	dynarray_ensure_capacity(&entities.registered, 1024);
 }
 
 void ent_shutdown(void) {
-	if(entities.registered.num_elements) {
-		log_fatal_if_debug("%u entities were not properly unregistered, this is a bug!", entities.registered.num_elements);
+	uint num_leaked = entities.registered.num_elements - entities.num_unregistered;
+
+	if(num_leaked) {
+		log_fatal_if_debug("%u entities were not properly unregistered, this is a bug!", num_leaked);
 	}
 
 	dynarray_free_data(&entities.registered);
+	dynarray_free_data(&entities.reinsert_buffer);
 
 	assert(entities.hooks.post_draw.first == NULL);
 	assert(entities.hooks.pre_draw.first == NULL);
+
+	for(uint i = 0; i < ARRAY_SIZE(entities.hooks.type_passes); ++i) {
+		assert(entities.hooks.type_passes[i].first == NULL);
+	}
+
+	for(uint i = 0; i < ARRAY_SIZE(entities.hooks.layer_passes); ++i) {
+		assert(entities.hooks.layer_passes[i].first == NULL);
+	}
+}
+
+/*
+ * Squeezes out the holes left by ent_unregister(), preserving the relative order of everything
+ * else. Used when entities are spawned without ever being drawn (skip mode, replay seeking,
+ * headless verification), so that the registry doesn't grow without bound between ent_draw()s.
+ */
+static void ent_compact_registry(void) {
+	EntityDrawOrderEntry *data = entities.registered.data;
+	dynarray_size_t num_total = entities.registered.num_elements;
+	dynarray_size_t num_sorted = 0;
+	dynarray_size_t num_kept = 0;
+
+	for(dynarray_size_t i = 0; i < num_total; ++i) {
+		EntityDrawOrderEntry e = data[i];
+
+		if(e.ent == NULL) {
+			continue;
+		}
+
+		if(i < entities.num_sorted) {
+			++num_sorted;
+		}
+
+		e.ent->index = num_kept;
+		data[num_kept++] = e;
+	}
+
+	entities.registered.num_elements = num_kept;
+	entities.num_sorted = num_sorted;
+	entities.num_unregistered = 0;
 }
 
 void ent_register(EntityInterface *ent, EntityType type) {
 	assert(type > _ENT_TYPE_ENUM_BEGIN && type < _ENT_TYPE_ENUM_END);
+
+	if(
+		!entities.drawing &&
+		entities.num_unregistered >= 1024 &&
+		entities.num_unregistered > entities.registered.num_elements / 2
+	) {
+		ent_compact_registry();
+	}
+
 	ent->type = type;
 	ent->spawn_id = ++entities.total_spawns;
 	ent->index = entities.registered.num_elements;
 	assume(ent->spawn_id > 0);
-	*dynarray_append(&entities.registered) = ent;
+	*dynarray_append(&entities.registered) = (EntityDrawOrderEntry) { .ent = ent };
 }
 
 void ent_unregister(EntityInterface *ent) {
 	ent->spawn_id = 0;
 
-	// Fast non-order-preserving removal by moving the last element into the removed element's position.
+	// Leave a hole to preserve the order; it'll be compacted on the next ent_draw(), or by
+	// ent_register() if enough of them pile up before that.
 
 	assert(ent->index < entities.registered.num_elements);
-	assert(dynarray_get(&entities.registered, ent->index) == ent);
-	EntityInterface *sub = entities.registered.data[--entities.registered.num_elements];
-	entities.registered.data[sub->index = ent->index] = sub;
+	assert(dynarray_get(&entities.registered, ent->index).ent == ent);
+	entities.registered.data[ent->index].ent = NULL;
+	++entities.num_unregistered;
 	del_ref(ent);
 }
 
 static int ent_cmp(const void *ptr1, const void *ptr2) {
-	const EntityInterface *ent1 = *(const EntityInterface**)ptr1;
-	const EntityInterface *ent2 = *(const EntityInterface**)ptr2;
+	const EntityDrawOrderEntry *e1 = ptr1;
+	const EntityDrawOrderEntry *e2 = ptr2;
 
-	int r = (ent1->draw_layer > ent2->draw_layer) - (ent1->draw_layer < ent2->draw_layer);
+	int r = (e1->layer > e2->layer) - (e1->layer < e2->layer);
 
 	if(r == 0) {
 		// Same layer? Put whatever spawned later on top, then.
-		r = (ent1->spawn_id > ent2->spawn_id) - (ent1->spawn_id < ent2->spawn_id);
+		r = (e1->ent->spawn_id > e2->ent->spawn_id) - (e1->ent->spawn_id < e2->ent->spawn_id);
 	}
 
 	return r;
 }
 
+/*
+ * Restores draw order after entities have been registered, unregistered, or moved to another
+ * layer. This is equivalent to sorting the whole array, but only the entities that actually
+ * changed get sorted; the rest are merged back in a single linear pass.
+ */
+static void ent_update_draw_order(void) {
+	EntityDrawOrderEntry *data = entities.registered.data;
+	dynarray_size_t num_total = entities.registered.num_elements;
+	dynarray_size_t num_kept = 0;
+
+	entities.reinsert_buffer.num_elements = 0;
+
+	for(dynarray_size_t i = 0; i < num_total; ++i) {
+		EntityDrawOrderEntry e = data[i];
+
+		if(e.ent == NULL) {
+			continue;
+		}
+
+		if(i < entities.num_sorted && e.layer == e.ent->draw_layer) {
+			e.ent->index = num_kept;
+			data[num_kept++] = e;
+		} else {
+			e.layer = e.ent->draw_layer;
+			*dynarray_append(&entities.reinsert_buffer) = e;
+		}
+	}
+
+	dynarray_size_t num_reinsert = entities.reinsert_buffer.num_elements;
+	entities.registered.num_elements = num_total = num_kept + num_reinsert;
+	entities.num_sorted = num_total;
+	entities.num_unregistered = 0;
+
+	if(num_reinsert == 0) {
+		return;
+	}
+
+	EntityDrawOrderEntry *reinsert = entities.reinsert_buffer.data;
+	qsort(reinsert, num_reinsert, sizeof(*reinsert), ent_cmp);
+
+	// Merge backwards, so that the kept entries don't get overwritten before they're moved.
+	dynarray_size_t k = num_kept - 1;
+	dynarray_size_t r = num_reinsert - 1;
+
+	for(dynarray_size_t i = num_total - 1; r >= 0; --i) {
+		if(k >= 0 && ent_cmp(data + k, reinsert + r) > 0) {
+			data[i] = data[k--];
+		} else {
+			data[i] = reinsert[r--];
+		}
+
+		data[i].ent->index = i;
+	}
+}
+
 static inline bool ent_is_drawable(EntityInterface *ent) {
 	return (ent->draw_layer & ~LAYER_LOW_MASK) > LAYER_NODRAW && ent->draw_func;
 }
 
+typedef struct EntityDrawPass {
+	EntityType type;
+	DrawLayerID layer;
+} EntityDrawPass;
+
+static void ent_switch_draw_pass(EntityDrawPass *pass, EntityType type, DrawLayerID layer) {
+	bool type_changed = pass->type != type;
+	bool layer_changed = pass->layer != layer;
+
+	// Passes nest as layer > type where possible: close the inner one first, open it last.
+
+	if(type_changed && pass->type != _ENT_TYPE_ENUM_BEGIN) {
+		call_pass_end_hooks(entities.hooks.type_passes + pass->type);
+	}
+
+	if(layer_changed && pass->layer != LAYER_ID_NONE) {
+		call_pass_end_hooks(entities.hooks.layer_passes + pass->layer);
+	}
+
+	if(layer_changed && layer != LAYER_ID_NONE) {
+		call_pass_begin_hooks(entities.hooks.layer_passes + layer);
+	}
+
+	if(type_changed && type != _ENT_TYPE_ENUM_BEGIN) {
+		call_pass_begin_hooks(entities.hooks.type_passes + type);
+	}
+
+	pass->type = type;
+	pass->layer = layer;
+}
+
+static inline void ent_draw_one(EntityInterface *ent, EntityDrawPass *pass) {
+	DrawLayerID layer = ent->draw_layer >> LAYER_LOW_BITS;
+	assert(layer < NUM_LAYER_IDS);
+
+	if(pass->type != ent->type || pass->layer != layer) {
+		ent_switch_draw_pass(pass, ent->type, layer);
+	}
+
+	call_hooks(&entities.hooks.pre_draw, ent);
+	r_state_push();
+	ent->draw_func(ent);
+	r_state_pop();
+	call_hooks(&entities.hooks.post_draw, ent);
+}
+
 void ent_draw(EntityPredicate predicate) {
+	EntityDrawPass pass = { _ENT_TYPE_ENUM_BEGIN, LAYER_ID_NONE };
+
 	call_hooks(&entities.hooks.pre_draw, NULL);
-	dynarray_qsort(&entities.registered, ent_cmp);
+	ent_update_draw_order();
+	entities.drawing = true;
 
 	if(predicate) {
-		dynarray_foreach(&entities.registered, int i, EntityInterface **pent, {
-			EntityInterface *ent = *pent;
-			ent->index = i;
+		dynarray_foreach_elem(&entities.registered, EntityDrawOrderEntry *pentry, {
+			EntityInterface *ent = pentry->ent;
 
 			if(ent_is_drawable(ent) && predicate(ent)) {
-				call_hooks(&entities.hooks.pre_draw, ent);
-				r_state_push();
-				ent->draw_func(ent);
-				r_state_pop();
-				call_hooks(&entities.hooks.post_draw, ent);
+				ent_draw_one(ent, &pass);
 			}
 		});
 	} else {
-		dynarray_foreach(&entities.registered, int i, EntityInterface **pent, {
-			EntityInterface *ent = *pent;
-			ent->index = i;
+		dynarray_foreach_elem(&entities.registered, EntityDrawOrderEntry *pentry, {
+			EntityInterface *ent = pentry->ent;
 
 			if(ent_is_drawable(ent)) {
-				call_hooks(&entities.hooks.pre_draw, ent);
-				r_state_push();
-				ent->draw_func(ent);
-				r_state_pop();
-				call_hooks(&entities.hooks.post_draw, ent);
+				ent_draw_one(ent, &pass);
 			}
 		});
 	}
 
+	entities.drawing = false;
+	ent_switch_draw_pass(&pass, _ENT_TYPE_ENUM_BEGIN, LAYER_ID_NONE);
 	call_hooks(&entities.hooks.post_draw, NULL);
 }
 
@@ -229,6 +443,26 @@ void ent_unhook_post_draw(EntityDrawHookCallback callback) {
 	remove_hook(&entities.hooks.post_draw, callback);
 }
 
+void ent_hook_type_draw_pass(EntityType type, EntityDrawPassCallback begin, EntityDrawPassCallback end, void *arg) {
+	assert(type > _ENT_TYPE_ENUM_BEGIN && type < _ENT_TYPE_ENUM_END);
+	add_pass_hook(entities.hooks.type_passes + type, begin, end, arg);
+}
+
+void ent_unhook_type_draw_pass(EntityType type, EntityDrawPassCallback begin, EntityDrawPassCallback end) {
+	assert(type > _ENT_TYPE_ENUM_BEGIN && type < _ENT_TYPE_ENUM_END);
+	remove_pass_hook(entities.hooks.type_passes + type, begin, end);
+}
+
+void ent_hook_layer_draw_pass(DrawLayerID layer, EntityDrawPassCallback begin, EntityDrawPassCallback end, void *arg) {
+	assert(layer > LAYER_ID_NONE && layer < NUM_LAYER_IDS);
+	add_pass_hook(entities.hooks.layer_passes + layer, begin, end, arg);
+}
+
+void ent_unhook_layer_draw_pass(DrawLayerID layer, EntityDrawPassCallback begin, EntityDrawPassCallback end) {
+	assert(layer > LAYER_ID_NONE && layer < NUM_LAYER_IDS);
+	remove_pass_hook(entities.hooks.layer_passes + layer, begin, end);
+}
+
 void _ent_array_compact_Entity(BoxedEntityArray *a) {
 	for(int i = 0; i < a->size; ++i) {
 		while(ENT_UNBOX(a->array[i]) == NULL) {
@@ -25,6 +25,7 @@ typedef enum DrawLayerID {
 	LAYER_ID_NONE,
 	#define LAYER(x) LAYER_ID_##x,
 	#include "drawlayers.inc.h"
+	NUM_LAYER_IDS,
 } DrawLayerID;
 
 typedef enum DrawLayer {
@@ -83,6 +84,7 @@ typedef void (*EntityDrawFunc)(EntityInterface *ent);
 typedef bool (*EntityPredicate)(EntityInterface *ent);
 typedef DamageResult (*EntityDamageFunc)(EntityInterface *target, const DamageInfo *damage);
 typedef void (*EntityDrawHookCallback)(EntityInterface *ent, void *arg);
+typedef void (*EntityDrawPassCallback)(void *arg);
 typedef void (*EntityAreaDamageCallback)(EntityInterface *ent, cmplx ent_origin, void *arg);
 
 #define ENTITY_INTERFACE_BASE(typename) struct { \
@@ -149,6 +151,14 @@ void ent_unhook_pre_draw(EntityDrawHookCallback callback);
 void ent_hook_post_draw(EntityDrawHookCallback callback, void *arg);
 void ent_unhook_post_draw(EntityDrawHookCallback callback);
 
+// Draw pass hooks run once per contiguous run of drawn entities of the given type (or on the given
+// layer) within an ent_draw() call: `begin` before the first entity of the run, `end` after the last.
+// Either callback may be NULL. Prefer these over the per-entity hooks above whenever possible.
+void ent_hook_type_draw_pass(EntityType type, EntityDrawPassCallback begin, EntityDrawPassCallback end, void *arg);
+void ent_unhook_type_draw_pass(EntityType type, EntityDrawPassCallback begin, EntityDrawPassCallback end);
+void ent_hook_layer_draw_pass(DrawLayerID layer, EntityDrawPassCallback begin, EntityDrawPassCallback end, void *arg);
+void ent_unhook_layer_draw_pass(DrawLayerID layer, EntityDrawPassCallback begin, EntityDrawPassCallback end);
+
 struct BoxedEntity {
 	EntityInterface *ent;
 	uint_fast32_t spawn_id;
@@ -166,7 +166,35 @@ void delete_items(void) {
 	}
 }
 
-static cmplx move_item(Item *i) {
+typedef struct ItemProcessContext {
+	// Looking sprites up by name for every item every frame adds up quickly after a big clear
+	Sprite *sprites[ITEM_LAST - ITEM_FIRST + 1];
+
+	// Items spawned together are adjacent in the list and share their age, so this is mostly a hit
+	int cached_t;
+	double cached_log;
+} ItemProcessContext;
+
+static void item_process_context_init(ItemProcessContext *ctx) {
+	for(ItemType type = ITEM_FIRST; type <= ITEM_LAST; ++type) {
+		ctx->sprites[type - ITEM_FIRST] = item_sprite(type);
+	}
+
+	ctx->cached_t = INT_MIN;
+}
+
+static inline Sprite *item_process_context_sprite(ItemProcessContext *ctx, ItemType type) {
+	assert(type >= ITEM_FIRST && type <= ITEM_LAST);
+	return ctx->sprites[type - ITEM_FIRST];
+}
+
+// Same as cabs(d) < r, but avoids the square root for most far away items:
+// cabs(d) is never smaller than the magnitude of either of its components.
+static inline bool item_within_radius(cmplx d, double r) {
+	return fabs(creal(d)) < r && fabs(cimag(d)) < r && cabs(d) < r;
+}
+
+static cmplx move_item(Item *i, ItemProcessContext *ctx) {
 	int t = global.frames - i->birthtime;
 	cmplx lim = 0 + 2.0*I;
 
@@ -175,10 +203,15 @@ static cmplx move_item(Item *i) {
 	if(i->auto_collect && i->collecttime <= global.frames && global.frames - i->birthtime > 20) {
 		i->pos -= (7+i->auto_collect)*cexp(I*carg(i->pos - global.plr.pos));
 	} else {
-		i->pos = i->pos0 + log(t/5.0 + 1)*5*(i->v + lim) + lim*t;
+		if(t != ctx->cached_t) {
+			ctx->cached_t = t;
+			ctx->cached_log = log(t/5.0 + 1);
+		}
+
+		i->pos = i->pos0 + ctx->cached_log*5*(i->v + lim) + lim*t;
 
 		cmplx v = i->pos - oldpos;
-		double half = item_sprite(i->type)->w/2.0;
+		double half = item_process_context_sprite(ctx, i->type)->w/2.0;
 		bool over = false;
 
 		if((over = creal(i->pos) > VIEWPORT_W-half) || creal(i->pos) < half) {
@@ -196,8 +229,9 @@ static cmplx move_item(Item *i) {
 	return i->pos - oldpos;
 }
 
-static bool item_out_of_bounds(Item *item) {
-	double margin = fmax(item_sprite(item->type)->w, item_sprite(item->type)->h);
+static bool item_out_of_bounds(Item *item, ItemProcessContext *ctx) {
+	Sprite *spr = item_process_context_sprite(ctx, item->type);
+	double margin = fmax(spr->w, spr->h);
 
 	return (
 		creal(item->pos) < -margin ||
@@ -236,9 +270,13 @@ void collect_all_items(float value) {
 void process_items(void) {
 	Item *item = global.items.first, *del = NULL;
 	float r = player_property(&global.plr, PLR_PROP_COLLECT_RADIUS);
+	double poc = player_property(&global.plr, PLR_PROP_POC);
 	bool plr_alive = player_is_alive(&global.plr);
 	bool stage_cleared = stage_is_cleared();
 
+	ItemProcessContext ctx;
+	item_process_context_init(&ctx);
+
 	while(item != NULL) {
 		bool may_collect = true;
 
@@ -266,9 +304,9 @@ void process_items(void) {
 
 		if(may_collect) {
 			if(plr_alive) {
-				if(cimag(global.plr.pos) < player_property(&global.plr, PLR_PROP_POC) || stage_cleared) {
+				if(cimag(global.plr.pos) < poc || stage_cleared) {
 					collect_item(item, 1);
-				} else if(cabs(global.plr.pos - item->pos) < r) {
+				} else if(item_within_radius(global.plr.pos - item->pos, r)) {
 					collect_item(item, 1 - cimag(global.plr.pos) / VIEWPORT_H);
 					item->auto_collect = 2;
 				}
@@ -280,7 +318,7 @@ void process_items(void) {
 			}
 		}
 
-		cmplx deltapos = move_item(item);
+		cmplx deltapos = move_item(item, &ctx);
 		int v = may_collect ? collision_item(item) : 0;
 
 		if(v == 1) {
@@ -329,7 +367,7 @@ void process_items(void) {
 			}
 		}
 
-		if(v == 1 || (cimag(deltapos) > 0 && item_out_of_bounds(item))) {
+		if(v == 1 || (cimag(deltapos) > 0 && item_out_of_bounds(item, &ctx))) {
 			del = item;
 			item = item->next;
 			delete_item(del);
@@ -340,7 +378,7 @@ void process_items(void) {
 }
 
 int collision_item(Item *i) {
-	if(cabs(global.plr.pos - i->pos) < 10)
+	if(item_within_radius(global.plr.pos - i->pos, 10))
 		return 1;
 
 	return 0;
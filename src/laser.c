@@ -9,6 +9,7 @@
 #include "taisei.h"
 
 #include "laser.h"
+#include "dynarray.h"
 #include "global.h"
 #include "list.h"
 #include "stageobjects.h"
@@ -18,26 +19,70 @@
 #include "util/fbmgr.h"
 #include "video.h"
 
-static struct {
+// The instance buffer grows on demand up to this size; beyond that, flushes are forced.
+#define LASER_BATCH_MIN_CAPACITY (sizeof(LaserSpecializedInstanceAttribs) * (1 << 12))
+#define LASER_BATCH_MAX_CAPACITY (sizeof(LaserSpecializedInstanceAttribs) * (1 << 15))
+
+typedef struct LaserBatchPipeline {
 	VertexArray *varr;
+	Model quad;
+} LaserBatchPipeline;
+
+static struct {
 	VertexBuffer *vbuf;
+	LaserBatchPipeline generic;
+	LaserBatchPipeline specialized;
 	ShaderProgram *shader_generic;
-	Model quad_generic;
 	Framebuffer *saved_fb;
 	Framebuffer *render_fb;
 	FBPair blur_fb_pair;
 	ManagedFramebufferGroup *mfb_group;
+	ResourceRef tex;
+
+	struct {
+		UniformRef tex;
+	} uniforms;
+
+	// Consecutive lasers drawn with the same shader are accumulated here and drawn with a single
+	// instanced draw call. Flushed when the shader changes and at the end of the laser draw pass.
+	struct {
+		ShaderProgram *shader;
+		uint num_instances;
+	} batch;
+
 	bool force_generic;
-} lasers;
+} lasers = {
+	.uniforms = {
+		.tex = UNIFORM_REF("tex"),
+	},
+};
 
-typedef struct LaserInstancedAttribs {
+#define LASER_UNIFORM(name) r_uniform_ref(&lasers.uniforms.name)
+
+// Per-segment attributes for lasers whose positions are computed on the CPU (lasers/generic)
+typedef struct LaserGenericInstanceAttribs {
+	Color color;
 	float pos[2];
 	float delta[2];
+	float width;
 	float fragment_width;
-} LaserInstancedAttribs;
+} LaserGenericInstanceAttribs;
+
+// Per-segment attributes for lasers whose positions are computed by a specialized shader.
+// The laser parameters are repeated for each segment, so that many lasers fit into one draw call.
+typedef struct LaserSpecializedInstanceAttribs {
+	Color color;
+	float origin[2];
+	float args[8];
+	float timeshift;
+	float width;
+	float width_exponent;
+	float span;
+	float segment;
+} LaserSpecializedInstanceAttribs;
 
-static void lasers_ent_predraw_hook(EntityInterface *ent, void *arg);
-static void lasers_ent_postdraw_hook(EntityInterface *ent, void *arg);
+static void lasers_draw_pass_begin(void *arg);
+static void lasers_draw_pass_end(void *arg);
 
 static void lasers_fb_resize_strategy(void *userdata, IntExtent *fb_size, FloatRect *fb_viewport) {
 	float w, h;
@@ -59,6 +104,20 @@ static void lasers_fb_resize_strategy(void *userdata, IntExtent *fb_size, FloatR
 	*fb_viewport = (FloatRect) { 0, 0, w, h };
 }
 
+static void lasers_init_pipeline(LaserBatchPipeline *p, const char *label, uint num_attribs, VertexAttribFormat fmt[num_attribs]) {
+	p->varr = r_vertex_array_create();
+	r_vertex_array_set_debug_label(p->varr, label);
+	r_vertex_array_layout(p->varr, num_attribs, fmt);
+	r_vertex_array_attach_vertex_buffer(p->varr, r_vertex_buffer_static_models(), 0);
+	r_vertex_array_attach_vertex_buffer(p->varr, lasers.vbuf, 1);
+
+	p->quad.num_indices = 0;
+	p->quad.num_vertices = 4;
+	p->quad.offset = 0;
+	p->quad.primitive = PRIM_TRIANGLE_STRIP;
+	p->quad.vertex_array = p->varr;
+}
+
 void lasers_preload(void) {
 	preload_resources(RES_SHADER_PROGRAM, RESF_DEFAULT,
 		"blur25",
@@ -67,34 +126,51 @@ void lasers_preload(void) {
 	NULL);
 
 	size_t sz_vert = sizeof(GenericModelVertex);
-	size_t sz_attr = sizeof(LaserInstancedAttribs);
+	size_t sz_gen = sizeof(LaserGenericInstanceAttribs);
+	size_t sz_spec = sizeof(LaserSpecializedInstanceAttribs);
 
 	#define VERTEX_OFS(attr)   offsetof(GenericModelVertex,  attr)
-	#define INSTANCE_OFS(attr) offsetof(LaserInstancedAttribs, attr)
+	#define GENERIC_OFS(attr)  offsetof(LaserGenericInstanceAttribs, attr)
+	#define SPECIAL_OFS(attr)  offsetof(LaserSpecializedInstanceAttribs, attr)
 
-	VertexAttribFormat fmt[] = {
+	VertexAttribFormat fmt_generic[] = {
 		// Per-vertex attributes (for the static models buffer, bound at 0)
 		{ { 2, VA_FLOAT, VA_CONVERT_FLOAT, 0 }, sz_vert, VERTEX_OFS(position),       0 },
 		{ { 2, VA_FLOAT, VA_CONVERT_FLOAT, 0 }, sz_vert, VERTEX_OFS(uv),             0 },
 
 		// Per-instance attributes (for our own buffer, bound at 1)
+		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_gen,  GENERIC_OFS(color),         1 },
 		// pos and delta packed into a single attribute
-		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(pos),            1 },
-		{ { 1, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_attr, INSTANCE_OFS(fragment_width), 1 },
+		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_gen,  GENERIC_OFS(pos),           1 },
+		// width and fragment_width packed into a single attribute
+		{ { 2, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_gen,  GENERIC_OFS(width),         1 },
+	};
+
+	VertexAttribFormat fmt_specialized[] = {
+		// Per-vertex attributes (for the static models buffer, bound at 0)
+		{ { 2, VA_FLOAT, VA_CONVERT_FLOAT, 0 }, sz_vert, VERTEX_OFS(position),       0 },
+		{ { 2, VA_FLOAT, VA_CONVERT_FLOAT, 0 }, sz_vert, VERTEX_OFS(uv),             0 },
+
+		// Per-instance attributes (for our own buffer, bound at 1)
+		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_spec, SPECIAL_OFS(color),         1 },
+		{ { 2, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_spec, SPECIAL_OFS(origin),        1 },
+		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_spec, SPECIAL_OFS(args[0]),       1 },
+		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_spec, SPECIAL_OFS(args[4]),       1 },
+		// timeshift, width, width_exponent and span packed into a single attribute
+		{ { 4, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_spec, SPECIAL_OFS(timeshift),     1 },
+		{ { 1, VA_FLOAT, VA_CONVERT_FLOAT, 1 }, sz_spec, SPECIAL_OFS(segment),       1 },
 	};
 
 	#undef VERTEX_OFS
-	#undef INSTANCE_OFS
+	#undef GENERIC_OFS
+	#undef SPECIAL_OFS
 
-	lasers.vbuf = r_vertex_buffer_create(sizeof(LaserInstancedAttribs) * 4096, NULL);
+	lasers.vbuf = r_vertex_buffer_create(LASER_BATCH_MIN_CAPACITY, NULL);
 	r_vertex_buffer_set_debug_label(lasers.vbuf, "Lasers vertex buffer");
+	r_vertex_buffer_invalidate(lasers.vbuf);
 
-	lasers.varr = r_vertex_array_create();
-	r_vertex_array_set_debug_label(lasers.varr, "Lasers vertex array");
-	r_vertex_array_layout(lasers.varr, sizeof(fmt)/sizeof(VertexAttribFormat), fmt);
-	r_vertex_array_attach_vertex_buffer(lasers.varr, r_vertex_buffer_static_models(), 0);
-	r_vertex_array_attach_vertex_buffer(lasers.varr, lasers.vbuf, 1);
-	r_vertex_array_layout(lasers.varr, sizeof(fmt)/sizeof(VertexAttribFormat), fmt);
+	lasers_init_pipeline(&lasers.generic, "Lasers vertex array (generic)", ARRAY_SIZE(fmt_generic), fmt_generic);
+	lasers_init_pipeline(&lasers.specialized, "Lasers vertex array (specialized)", ARRAY_SIZE(fmt_specialized), fmt_specialized);
 
 	FBAttachmentConfig aconf = { 0 };
 	aconf.attachment = FRAMEBUFFER_ATTACH_COLOR0;
@@ -114,14 +190,7 @@ void lasers_preload(void) {
 	fbconf.resize_strategy.userdata = (void*)(uintptr_t)true;
 	fbmgr_group_fbpair_create(lasers.mfb_group, "Lasers blur", &fbconf, &lasers.blur_fb_pair);
 
-	ent_hook_pre_draw(lasers_ent_predraw_hook, NULL);
-	ent_hook_post_draw(lasers_ent_postdraw_hook, NULL);
-
-	lasers.quad_generic.num_indices = 0;
-	lasers.quad_generic.num_vertices = 4;
-	lasers.quad_generic.offset = 0;
-	lasers.quad_generic.primitive = PRIM_TRIANGLE_STRIP;
-	lasers.quad_generic.vertex_array = lasers.varr;
+	ent_hook_type_draw_pass(ENT_TYPE_ID(Laser), lasers_draw_pass_begin, lasers_draw_pass_end, NULL);
 
 	lasers.shader_generic = res_shader("lasers/generic");
 
@@ -130,10 +199,10 @@ void lasers_preload(void) {
 
 void lasers_free(void) {
 	fbmgr_group_destroy(lasers.mfb_group);
-	r_vertex_array_destroy(lasers.varr);
+	r_vertex_array_destroy(lasers.generic.varr);
+	r_vertex_array_destroy(lasers.specialized.varr);
 	r_vertex_buffer_destroy(lasers.vbuf);
-	ent_unhook_pre_draw(lasers_ent_predraw_hook);
-	ent_unhook_post_draw(lasers_ent_postdraw_hook);
+	ent_unhook_type_draw_pass(ENT_TYPE_ID(Laser), lasers_draw_pass_begin, lasers_draw_pass_end);
 }
 
 static void ent_draw_laser(EntityInterface *ent);
@@ -193,6 +262,70 @@ static float laser_graze_width(Laser *l, float *exponent) {
 	return 5.0f * sqrtf(l->width) + 15.0f;
 }
 
+// Time between two consecutive samples of the laser curve. Matches the segment size used for drawing.
+#define LASER_SAMPLE_STEP 0.5f
+
+// Everything the sampled points of a laser depend on.
+typedef struct LaserSamplingKey {
+	LaserPosRule prule;
+	cmplx pos;
+	cmplx args[4];
+} LaserSamplingKey;
+
+struct LaserSampleCache {
+	DYNAMIC_ARRAY(cmplx) points;
+	LaserSamplingKey key;
+	float t_start;
+};
+
+/*
+ * Samples the curve of [l] at t_start + i * LASER_SAMPLE_STEP, for i < num_points.
+ *
+ * Position rules are assumed to depend only on the parameters in LaserSamplingKey and on time,
+ * so samples stay valid across frames. As the laser moves along its curve, the samples it still
+ * covers are reused if it moved by a whole number of steps, which is the case at speed 1.
+ */
+static LaserSampleCache *laser_samples_prepare(Laser *l, float t_start, uint num_points) {
+	LaserSampleCache *cache = l->samples;
+
+	if(!cache) {
+		cache = l->samples = calloc(1, sizeof(*cache));
+	}
+
+	LaserSamplingKey key;
+	memset(&key, 0, sizeof(key));
+	key.prule = l->prule;
+	key.pos = l->pos;
+	memcpy(key.args, l->args, sizeof(key.args));
+
+	if(memcmp(&key, &cache->key, sizeof(key))) {
+		cache->key = key;
+		cache->points.num_elements = 0;
+	} else if(t_start != cache->t_start) {
+		float shift = (t_start - cache->t_start) / LASER_SAMPLE_STEP;
+
+		if(shift > 0 && shift == truncf(shift) && shift < cache->points.num_elements) {
+			uint ishift = shift;
+			cache->points.num_elements -= ishift;
+			memmove(cache->points.data, cache->points.data + ishift, cache->points.num_elements * sizeof(*cache->points.data));
+		} else {
+			cache->points.num_elements = 0;
+		}
+	}
+
+	cache->t_start = t_start;
+
+	if(num_points > cache->points.num_elements) {
+		dynarray_ensure_capacity(&cache->points, num_points);
+
+		for(uint i = cache->points.num_elements; i < num_points; ++i) {
+			*dynarray_append(&cache->points) = l->prule(l, t_start + i * LASER_SAMPLE_STEP);
+		}
+	}
+
+	return cache;
+}
+
 static bool draw_laser_instanced_prepare(Laser *l, uint *out_instances, float *out_timeshift) {
 	float t;
 	int c;
@@ -219,6 +352,67 @@ static bool draw_laser_instanced_prepare(Laser *l, uint *out_instances, float *o
 	return true;
 }
 
+static void lasers_flush(void) {
+	uint instances = lasers.batch.num_instances;
+
+	if(instances == 0) {
+		return;
+	}
+
+	lasers.batch.num_instances = 0;
+
+	ShaderProgram *shader = NOT_NULL(lasers.batch.shader);
+	LaserBatchPipeline *p = shader == lasers.shader_generic ? &lasers.generic : &lasers.specialized;
+
+	r_state_push();
+	r_shader_ptr(shader);
+	r_uniform_sampler(LASER_UNIFORM(tex), res_texture_ref(&lasers.tex, "part/lasercurve"));
+	r_draw_model_ptr(&p->quad, instances, 0);
+	r_vertex_buffer_invalidate(lasers.vbuf);
+	r_state_pop();
+}
+
+/*
+ * Makes room for [num_instances] more instances of [attr_size] bytes each in the current batch,
+ * flushing it first if it was built for a different shader or if the buffer can't grow any more.
+ * The caller must write all of them, then call lasers_batch_commit().
+ */
+static void *lasers_batch_reserve(ShaderProgram *shader, size_t attr_size, uint num_instances) {
+	if(lasers.batch.shader != shader) {
+		lasers_flush();
+		lasers.batch.shader = shader;
+	}
+
+	VertexBuffer *vbuf = lasers.vbuf;
+	size_t size = attr_size * num_instances;
+	size_t available;
+	void *buf = r_vertex_buffer_map_write(vbuf, &available);
+
+	if(available < size) {
+		size_t capacity = SDL_RWsize(r_vertex_buffer_get_stream(vbuf));
+		size_t required = capacity - available + size;
+
+		if(required > LASER_BATCH_MAX_CAPACITY) {
+			lasers_flush();
+			required = size;
+		}
+
+		if(required > capacity) {
+			r_vertex_buffer_resize(vbuf, required);
+		}
+
+		buf = r_vertex_buffer_map_write(vbuf, &available);
+		assert(available >= size);
+	}
+
+	return buf;
+}
+
+static void lasers_batch_commit(size_t attr_size, uint num_instances) {
+	r_vertex_buffer_unmap_write(lasers.vbuf, attr_size * num_instances);
+	lasers.batch.num_instances += num_instances;
+}
+
 static void draw_laser_curve_specialized(Laser *l) {
 	float timeshift;
 	uint instances;
@@ -229,33 +423,29 @@ static void draw_laser_curve_specialized(Laser *l) {
 		return;
 	}
 
-	r_shader_ptr(l->shader);
-	r_color(&l->color);
-	r_uniform_sampler("tex", "part/lasercurve");
-	r_uniform_vec2_complex("origin", l->pos);
-	r_uniform_vec2_array_complex("args[0]", 0, 4, l->args);
-	r_uniform_float("timeshift", timeshift);
-	r_uniform_float("width", l->width);
-	r_uniform_float("width_exponent", l->width_exponent);
-	r_uniform_int("span", instances);
+	LaserSpecializedInstanceAttribs attr;
+	attr.color = l->color;
+	attr.origin[0] = creal(l->pos);
+	attr.origin[1] = cimag(l->pos);
 
-#if 1
-	r_draw_model_ptr(&lasers.quad_generic, instances, 0);
-#else
-	double graze_exp;
+	for(uint i = 0; i < ARRAY_SIZE(l->args); ++i) {
+		attr.args[i * 2 + 0] = creal(l->args[i]);
+		attr.args[i * 2 + 1] = cimag(l->args[i]);
+	}
+
+	attr.timeshift = timeshift;
+	attr.width = l->width;
+	attr.width_exponent = l->width_exponent;
+	attr.span = instances;
 
-	r_color(RGBA(0, 0, 0.2, 0.2));
-	r_uniform_sampler("tex", "part/lasercurve");
-	r_uniform_float("width", 2 * laser_graze_width(l, &graze_exp));
-	r_uniform_float("width_exponent", graze_exp);
-	r_draw_model_ptr(&lasers.quad_generic, instances, 0);
+	LaserSpecializedInstanceAttribs *out = lasers_batch_reserve(l->shader, sizeof(attr), instances);
 
-	r_color(&l->color);
-	r_uniform_sampler("tex", "part/lasercurve");
-	r_uniform_float("width", l->width);
-	r_uniform_float("width_exponent", l->width_exponent);
-	r_draw_model_ptr(&lasers.quad_generic, instances, 0);
-#endif
+	for(uint i = 0; i < instances; ++i) {
+		attr.segment = i;
+		out[i] = attr;
+	}
+
+	lasers_batch_commit(sizeof(attr), instances);
 }
 
 static void draw_laser_curve_generic(Laser *l) {
@@ -266,38 +456,42 @@ static void draw_laser_curve_generic(Laser *l) {
 		return;
 	}
 
-	r_shader_ptr(lasers.shader_generic);
-	r_color(&l->color);
-	r_uniform_sampler("tex", "part/lasercurve");
-	r_uniform_float("timeshift", timeshift);
-	r_uniform_float("width", l->width);
-	r_uniform_float("width_exponent", l->width_exponent);
-	r_uniform_int("span", instances);
-
-	SDL_RWops *stream = r_vertex_buffer_get_stream(lasers.vbuf);
-	r_vertex_buffer_invalidate(lasers.vbuf);
+	LaserGenericInstanceAttribs *out = lasers_batch_reserve(lasers.shader_generic, sizeof(*out), instances);
+	LaserSampleCache *samples = laser_samples_prepare(l, timeshift, instances);
 
 	float tail = instances / 1.6;
 	float width_factor = -1 / (tail * tail);
 
+	// The direction of each segment is taken from the difference to the previous sample,
+	// scaled down to the 0.1 time step that the shaders use.
+	const float delta_scale = 0.1f / LASER_SAMPLE_STEP;
+	cmplx prev_pos = dynarray_get(&samples->points, 0);
+
+	if(instances > 1) {
+		prev_pos -= dynarray_get(&samples->points, 1) - prev_pos;
+	}
+
 	for(uint i = 0; i < instances; ++i) {
-		cmplx pos = l->prule(l, i * 0.5 + timeshift);
-		cmplx delta = pos - l->prule(l, i * 0.5 + timeshift - 0.1);
+		cmplx pos = dynarray_get(&samples->points, i);
+		cmplx delta = (pos - prev_pos) * delta_scale;
+		prev_pos = pos;
 
 		float mid_ofs = i - instances * 0.5;
 		float w = 0.75f * powf(width_factor * (mid_ofs - tail) * (mid_ofs + tail), l->width_exponent);
 
-		LaserInstancedAttribs attr;
+		LaserGenericInstanceAttribs attr;
+		attr.color = l->color;
 		attr.pos[0] = creal(pos);
 		attr.pos[1] = cimag(pos);
 		attr.delta[0] = creal(delta);
 		attr.delta[1] = cimag(delta);
+		attr.width = l->width;
 		attr.fragment_width = w;
 
-		SDL_RWwrite(stream, &attr, sizeof(attr), 1);
+		out[i] = attr;
 	}
 
-	r_draw_model_ptr(&lasers.quad_generic, instances, 0);
+	lasers_batch_commit(sizeof(*out), instances);
 }
 
 static void ent_draw_laser(EntityInterface *ent) {
@@ -310,61 +504,37 @@ static void ent_draw_laser(EntityInterface *ent) {
 	}
 }
 
-static void lasers_ent_predraw_hook(EntityInterface *ent, void *arg) {
-	int pp_quality = config_get_int(CONFIG_POSTPROCESS);
-
-	if(pp_quality < 1) {
+static void lasers_draw_pass_begin(void *arg) {
+	if(config_get_int(CONFIG_POSTPROCESS) < 1) {
 		return;
 	}
 
-	if(ent && ent->type == ENT_TYPE_ID(Laser)) {
-		if(lasers.saved_fb != NULL) {
-			return;
-		}
-
-		lasers.saved_fb = r_framebuffer_current();
-		r_framebuffer(lasers.render_fb);
-		r_clear(CLEAR_COLOR, RGBA(0, 0, 0, 0), 1);
-	} else {
-		if(lasers.saved_fb == NULL) {
-			return;
-		}
-
-		FBPair *fbpair = &lasers.blur_fb_pair;
-
-		stage_draw_begin_noshake();
-
-		r_framebuffer(lasers.saved_fb);
-		r_state_push();
-		r_blend(BLEND_NONE);
-
-		if(pp_quality > 1) {
-			// Ambient glow pass (large kernel)
+	assert(lasers.saved_fb == NULL);
+	lasers.saved_fb = r_framebuffer_current();
+	r_framebuffer(lasers.render_fb);
+	r_clear(CLEAR_COLOR, RGBA(0, 0, 0, 0), 1);
+}
 
-			r_shader("blur25");
-			r_uniform_vec2("blur_resolution", VIEWPORT_W, VIEWPORT_H);
+static void lasers_draw_pass_end(void *arg) {
+	lasers_flush();
 
-			r_framebuffer(fbpair->back);
-			r_uniform_vec2("blur_direction", 1, 0);
-			draw_framebuffer_tex(lasers.render_fb, VIEWPORT_W, VIEWPORT_H);
+	if(lasers.saved_fb == NULL) {
+		return;
+	}
 
-			fbpair_swap(fbpair);
+	int pp_quality = config_get_int(CONFIG_POSTPROCESS);
+	FBPair *fbpair = &lasers.blur_fb_pair;
 
-			r_framebuffer(fbpair->back);
-			r_uniform_vec2("blur_direction", 0, 1);
-			draw_framebuffer_tex(fbpair->front, VIEWPORT_W, VIEWPORT_H);
+	stage_draw_begin_noshake();
 
-			fbpair_swap(fbpair);
+	r_framebuffer(lasers.saved_fb);
+	r_state_push();
+	r_blend(BLEND_NONE);
 
-			r_framebuffer(lasers.saved_fb);
-			r_blend(BLEND_PREMUL_ALPHA);
-			r_shader_standard();
-			draw_framebuffer_tex(fbpair->front, VIEWPORT_W, VIEWPORT_H);
-			r_blend(BLEND_NONE);
-		}
+	if(pp_quality > 1) {
+		// Ambient glow pass (large kernel)
 
-		// Smoothed laser curves pass (small kernel)
-		r_shader("blur5");
+		r_shader("blur25");
 		r_uniform_vec2("blur_resolution", VIEWPORT_W, VIEWPORT_H);
 
 		r_framebuffer(fbpair->back);
@@ -383,18 +553,33 @@ static void lasers_ent_predraw_hook(EntityInterface *ent, void *arg) {
 		r_blend(BLEND_PREMUL_ALPHA);
 		r_shader_standard();
 		draw_framebuffer_tex(fbpair->front, VIEWPORT_W, VIEWPORT_H);
-
-		r_state_pop();
-		stage_draw_end_noshake();
-		lasers.saved_fb = NULL;
+		r_blend(BLEND_NONE);
 	}
-}
 
-static void lasers_ent_postdraw_hook(EntityInterface *ent, void *arg) {
-	if(ent == NULL) {
-		// Edge case when the last entity drawn is a laser
-		lasers_ent_predraw_hook(NULL, arg);
-	}
+	// Smoothed laser curves pass (small kernel)
+	r_shader("blur5");
+	r_uniform_vec2("blur_resolution", VIEWPORT_W, VIEWPORT_H);
+
+	r_framebuffer(fbpair->back);
+	r_uniform_vec2("blur_direction", 1, 0);
+	draw_framebuffer_tex(lasers.render_fb, VIEWPORT_W, VIEWPORT_H);
+
+	fbpair_swap(fbpair);
+
+	r_framebuffer(fbpair->back);
+	r_uniform_vec2("blur_direction", 0, 1);
+	draw_framebuffer_tex(fbpair->front, VIEWPORT_W, VIEWPORT_H);
+
+	fbpair_swap(fbpair);
+
+	r_framebuffer(lasers.saved_fb);
+	r_blend(BLEND_PREMUL_ALPHA);
+	r_shader_standard();
+	draw_framebuffer_tex(fbpair->front, VIEWPORT_W, VIEWPORT_H);
+
+	r_state_pop();
+	stage_draw_end_noshake();
+	lasers.saved_fb = NULL;
 }
 
 static void* _delete_laser(ListAnchor *lasers, List *laser, void *arg) {
@@ -404,6 +589,11 @@ static void* _delete_laser(ListAnchor *lasers, List *laser, void *arg) {
 		l->lrule(l, EVENT_DEATH);
 
 	ent_unregister(&l->ent);
+	if(l->samples) {
+		dynarray_free_data(&l->samples->points);
+		free(l->samples);
+	}
+
 	objpool_release(stage_object_pools.lasers, alist_unlink(lasers, laser));
 	return NULL;
 }
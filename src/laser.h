@@ -21,6 +21,8 @@ typedef LIST_ANCHOR(Laser) LaserList;
 typedef cmplx (*LaserPosRule)(Laser* l, float time);
 typedef void (*LaserLogicRule)(Laser* l, int time);
 
+typedef struct LaserSampleCache LaserSampleCache;
+
 DEFINE_ENTITY_TYPE(Laser, {
 	cmplx pos;
 	cmplx args[4];
@@ -44,6 +46,10 @@ DEFINE_ENTITY_TYPE(Laser, {
 
 	uchar unclearable : 1;
 	uchar collision_active : 1;
+
+	// Points along the curve, kept across frames for the generic drawing path.
+	// Only allocated once the laser is drawn without a specialized shader.
+	LaserSampleCache *samples;
 });
 
 #define create_lasercurve1c(p, time, deathtime, clr, rule, a0) create_laser(p, time, deathtime, clr, rule, 0, a0, 0, 0, 0)
@@ -30,11 +30,15 @@
 #include "util/gamemode.h"
 #include "cutscenes/cutscene.h"
 #include "replay/struct.h"
+#include "replay/verify.h"
+#include "benchmark.h"
 
 attr_unused
 static void taisei_shutdown(void) {
 	log_info("Shutting down");
 
+	bench_shutdown();
+
 	if(!global.is_replay_verification) {
 		config_save();
 		progress_save();
@@ -186,6 +190,7 @@ typedef struct MainContext {
 	Replay *replay_in;
 	Replay *replay_out;
 	SDL_RWops *replay_out_stream;
+	char *replay_batch_path;
 	int replay_idx;
 	uchar headless : 1;
 } MainContext;
@@ -194,6 +199,7 @@ static void main_post_vfsinit(CallChainResult ccr);
 static void main_mainmenu(CallChainResult ccr);
 static void main_singlestg(MainContext *mctx) attr_unused;
 static void main_replay(MainContext *mctx);
+static void main_verify_replay_batch(MainContext *mctx);
 static noreturn void main_vfstree(CallChainResult ccr);
 
 static void cleanup_replay(Replay **rpy) {
@@ -229,6 +235,7 @@ static noreturn void main_quit(MainContext *ctx, int status) {
 	}
 
 	cleanup_replay(&ctx->replay_out);
+	free(ctx->replay_batch_path);
 
 	free(ctx);
 	exit(status);
@@ -270,7 +277,15 @@ int main(int argc, char **argv) {
 		main_quit(ctx, 0);
 	}
 
-	if(ctx->cli.type == CLI_PlayReplay || ctx->cli.type == CLI_VerifyReplay) {
+	if(ctx->cli.type == CLI_BenchMixer) {
+		main_quit(ctx, bench_mixer(ctx->cli.bench_report));
+	}
+
+	if(
+		ctx->cli.type == CLI_PlayReplay ||
+		ctx->cli.type == CLI_VerifyReplay ||
+		ctx->cli.type == CLI_BenchReplay
+	) {
 		ctx->replay_in = alloc_replay();
 
 		if(!replay_load_syspath(ctx->replay_in, ctx->cli.filename, REPLAY_READ_ALL)) {
@@ -283,10 +298,18 @@ int main(int argc, char **argv) {
 			main_quit(ctx, 1);
 		}
 
-		if(ctx->cli.type == CLI_VerifyReplay) {
+		if(ctx->cli.type == CLI_VerifyReplay || ctx->cli.type == CLI_BenchReplay) {
 			ctx->headless = true;
 		}
 
+		if(ctx->cli.type == CLI_BenchReplay) {
+			bench_init(ctx->cli.filename, ctx->cli.bench_report);
+
+			// Preload stage resources up front (unless overridden), so that their load time is
+			// reported on its own rather than inflating the first logic frames that use them.
+			env_set("TAISEI_NOPRELOAD", false, false);
+		}
+
 		if(ctx->cli.out_replay != NULL) {
 			ctx->replay_out_stream = SDL_RWFromFile(ctx->cli.out_replay, "wb");
 
@@ -296,6 +319,9 @@ int main(int argc, char **argv) {
 
 			ctx->replay_out = alloc_replay();
 		}
+	} else if(ctx->cli.type == CLI_VerifyReplayBatch) {
+		stralloc(&ctx->replay_batch_path, ctx->cli.filename);
+		ctx->headless = true;
 	} else if(ctx->cli.type == CLI_DumpVFSTree) {
 		vfs_setup(CALLCHAIN(main_vfstree, ctx));
 		return 0; // NO main_quit here! vfs_setup may be asynchronous.
@@ -355,11 +381,20 @@ static void main_post_vfsinit(CallChainResult ccr) {
 	atexit(taisei_shutdown);
 #endif
 
-	if(ctx->cli.type == CLI_PlayReplay || ctx->cli.type == CLI_VerifyReplay) {
+	if(
+		ctx->cli.type == CLI_PlayReplay ||
+		ctx->cli.type == CLI_VerifyReplay ||
+		ctx->cli.type == CLI_BenchReplay
+	) {
 		main_replay(ctx);
 		return;
 	}
 
+	if(ctx->cli.type == CLI_VerifyReplayBatch) {
+		main_verify_replay_batch(ctx);
+		return;
+	}
+
 	if(ctx->cli.type == CLI_Credits) {
 		credits_enter(CALLCHAIN(main_cleanup, ctx));
 		eventloop_run();
@@ -482,6 +517,16 @@ static void main_replay(MainContext *mctx) {
 	eventloop_run();
 }
 
+static void main_verify_replay_batch_done(CallChainResult ccr) {
+	int num_failed = (intptr_t)ccr.result;
+	main_quit(ccr.ctx, num_failed > 0);
+}
+
+static void main_verify_replay_batch(MainContext *mctx) {
+	replay_verify_batch(mctx->replay_batch_path, CALLCHAIN(main_verify_replay_batch_done, mctx));
+	eventloop_run();
+}
+
 static void main_vfstree(CallChainResult ccr) {
 	MainContext *mctx = ccr.ctx;
 	SDL_RWops *rwops = SDL_RWFromFP(stdout, false);
@@ -137,6 +137,11 @@ static void skip_stage(MenuData *m, void *arg) {
 	menu_action_close(m, arg);
 }
 
+static void seek_replay(MenuData *m, void *arg) {
+	stage_replay_seek(imax(0, global.frames + (int)(intptr_t)arg));
+	menu_action_close(m, arg);
+}
+
 MenuData* create_ingame_menu_replay(void) {
 	MenuData *m = alloc_menu();
 
@@ -148,6 +153,8 @@ MenuData* create_ingame_menu_replay(void) {
 	m->context = "Replay Paused";
 	add_menu_entry(m, "Options", menu_action_enter_options, NULL)->transition = TransFadeBlack;
 	add_menu_entry(m, "Continue Watching", menu_action_close, NULL);
+	add_menu_entry(m, "Rewind 10 Seconds", seek_replay, (void*)(intptr_t)(-10 * FPS))->transition = TransFadeBlack;
+	add_menu_entry(m, "Skip Ahead 10 Seconds", seek_replay, (void*)(intptr_t)(10 * FPS));
 	add_menu_entry(m, "Restart the Stage", restart_game, NULL)->transition = TransFadeBlack;
 	add_menu_entry(m, "Skip the Stage", skip_stage, NULL)->transition = TransFadeBlack;
 	add_menu_entry(m, "Stop Watching", return_to_title, NULL)->transition = TransFadeBlack;
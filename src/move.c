@@ -9,22 +9,6 @@
 #include "taisei.h"
 
 #include "move.h"
-#include "util/miscmath.h"
-
-cmplx move_update(cmplx *restrict pos, MoveParams *restrict p) {
-	cmplx v = p->velocity;
-
-	*pos += v;
-	p->velocity = p->acceleration + p->retention * v;
-
-	if(p->attraction) {
-		cmplx av = p->attraction_point - *pos;
-
-		p->velocity += p->attraction * cnormalize(av) * pow(cabs(av), p->attraction_exponent);
-	}
-
-	return v;
-}
 
 cmplx move_update_multiple(uint times, cmplx *restrict pos, MoveParams *restrict p) {
 	cmplx v = p->velocity;
@@ -11,6 +11,8 @@
 
 #include "taisei.h"
 
+#include "util/miscmath.h"
+
 /*
  * Simple generalized projectile movement based on laochailan's idea
  */
@@ -22,9 +24,26 @@ typedef struct MoveParams {
 	real attraction_exponent;
 } MoveParams;
 
-cmplx move_update(cmplx *restrict pos, MoveParams *restrict params);
 cmplx move_update_multiple(uint times, cmplx *restrict pos, MoveParams *restrict params);
 
+/*
+ * Defined inline, because this is called for nearly every projectile on every frame.
+ */
+INLINE cmplx move_update(cmplx *restrict pos, MoveParams *restrict p) {
+	cmplx v = p->velocity;
+
+	*pos += v;
+	p->velocity = p->acceleration + p->retention * v;
+
+	if(p->attraction) {
+		cmplx av = p->attraction_point - *pos;
+
+		p->velocity += p->attraction * cnormalize(av) * pow(cabs(av), p->attraction_exponent);
+	}
+
+	return v;
+}
+
 INLINE MoveParams move_linear(cmplx vel) {
 	return (MoveParams) { vel, 0, 1 };
 }
@@ -17,8 +17,10 @@
 	#define OBJPOOL_DEBUG
 #endif
 
+// Cheap enough to always have; needed for --bench-replay reports in release builds.
+#define OBJPOOL_TRACK_STATS
+
 #ifdef OBJPOOL_DEBUG
-	#define OBJPOOL_TRACK_STATS
 	#define IF_OBJPOOL_DEBUG(code) code
 #else
 	#define IF_OBJPOOL_DEBUG(code)
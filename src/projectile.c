@@ -13,6 +13,7 @@
 #include "global.h"
 #include "list.h"
 #include "stageobjects.h"
+#include "enemy_grid.h"
 #include "util/glm.h"
 
 static ht_ptr2int_t shader_sublayer_map;
@@ -53,7 +54,7 @@ static void process_projectile_args(ProjArgs *args, ProjArgs *defaults) {
 
 	if(!args->shader_ptr) {
 		if(args->shader) {
-			args->shader_ptr = res_shader(args->shader);
+			args->shader_ptr = res_shader_cached(args->shader);
 		} else {
 			args->shader_ptr = defaults->shader_ptr;
 		}
@@ -144,6 +145,8 @@ static inline int proj_call_rule(Projectile *p, int t) {
 	if(p->timeout > 0 && t >= p->timeout) {
 		result = ACTION_DESTROY;
 	} else if(p->rule != NULL) {
+		// Legacy rules may do anything, including moving enemies around.
+		enemy_grid_invalidate();
 		result = p->rule(p, t);
 
 		if(t < 0 && result != ACTION_ACK) {
@@ -408,14 +411,14 @@ void calc_projectile_collision(Projectile *p, ProjCollisionResult *out_col) {
 			}
 		}
 	} else if(p->type == PROJ_PLAYER) {
-		for(Enemy *e = global.enemies.first; e; e = e->next) {
-			if(!(e->flags & EFLAG_NO_HIT) && cabs(e->pos - p->pos) < e->hit_radius) {
-				out_col->type = PCOL_ENTITY;
-				out_col->entity = &e->ent;
-				out_col->fatal = !(p->flags & PFLAG_INDESTRUCTIBLE);
+		Enemy *e = enemy_grid_find_hit(&global.enemies, p->pos);
 
-				return;
-			}
+		if(e) {
+			out_col->type = PCOL_ENTITY;
+			out_col->entity = &e->ent;
+			out_col->fatal = !(p->flags & PFLAG_INDESTRUCTIBLE);
+
+			return;
 		}
 
 		if(global.boss && cabs(global.boss->pos - p->pos) < 42) {
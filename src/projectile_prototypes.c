@@ -14,22 +14,20 @@
 
 typedef struct PPBasicPriv {
 	const char *sprite_name;
-	Sprite *sprite;
+	ResourceRef sprite;
 	cmplx size;
 	cmplx collision_size;
 } PPBasicPriv;
 
 static void pp_basic_preload(ProjPrototype *proto) {
 	preload_resource(RES_SPRITE, ((PPBasicPriv*)proto->private)->sprite_name, RESF_PERMANENT);
-	// not assigning ->sprite here because it'll block the thread until loaded
+	// not resolving ->sprite here because it'll block the thread until loaded
 }
 
 static void pp_basic_init_projectile(ProjPrototype *proto, Projectile *p) {
 	PPBasicPriv *pdata = proto->private;
 
-	p->sprite = pdata->sprite
-		? pdata->sprite
-		: (pdata->sprite = res_sprite(pdata->sprite_name));
+	p->sprite = res_sprite_ref(&pdata->sprite, pdata->sprite_name);
 
 	p->size = pdata->size;
 	p->collision_size = pdata->collision_size;
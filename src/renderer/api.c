@@ -22,11 +22,25 @@
 
 #define B _r_backend.funcs
 
+#define UNIFORM_CACHE_SIZE 256
+#define UNIFORM_CACHE_MAX_NAME 32
+
+typedef struct UniformCacheEntry {
+	UniformRef ref;
+	char name[UNIFORM_CACHE_MAX_NAME];
+} UniformCacheEntry;
+
 static struct {
 	struct {
 		ShaderProgram *standard;
 		ShaderProgram *standardnotex;
 	} progs;
+
+	// Incremented whenever a shader program is destroyed, invalidating all UniformRefs.
+	// A new program may be allocated at the same address.
+	uint32_t progs_generation;
+
+	UniformCacheEntry uniform_cache[UNIFORM_CACHE_SIZE];
 } R;
 
 void r_init(void) {
@@ -355,6 +369,7 @@ ShaderProgram* r_shader_program_link(uint num_objects, ShaderObject *shobjs[num_
 }
 
 void r_shader_program_destroy(ShaderProgram *prog) {
+	++R.progs_generation;
 	B.shader_program_destroy(prog);
 }
 
@@ -383,6 +398,56 @@ UniformType r_uniform_type(Uniform *uniform) {
 	return B.uniform_type(uniform);
 }
 
+static inline bool uniform_ref_valid(UniformRef *ref, ShaderProgram *prog) {
+	return ref->prog == prog && ref->generation == R.progs_generation;
+}
+
+static void uniform_ref_resolve(UniformRef *ref, ShaderProgram *prog) {
+	if(!ref->name_hash) {
+		ref->name_hash = ht_str2ptr_hash(ref->name);
+	}
+
+	ref->prog = prog;
+	ref->generation = R.progs_generation;
+	ref->uniform = _r_shader_uniform(prog, ref->name, ref->name_hash);
+}
+
+Uniform* r_uniform_ref(UniformRef *ref) {
+	ShaderProgram *prog = r_shader_current();
+
+	if(!uniform_ref_valid(ref, prog)) {
+		uniform_ref_resolve(ref, prog);
+	}
+
+	return ref->uniform;
+}
+
+Uniform* r_shader_current_uniform(const char *name) {
+	ShaderProgram *prog = r_shader_current();
+
+	uintptr_t key = ((uintptr_t)name >> 2) ^ ((uintptr_t)prog >> 4);
+	key ^= key >> 9;
+	key ^= key >> 17;
+
+	UniformCacheEntry *e = R.uniform_cache + (key & (UNIFORM_CACHE_SIZE - 1));
+
+	if(e->ref.name == name && uniform_ref_valid(&e->ref, prog) && !strcmp(e->name, name)) {
+		return e->ref.uniform;
+	}
+
+	size_t name_len = strlen(name);
+
+	if(name_len >= sizeof(e->name)) {
+		return r_shader_uniform(prog, name);
+	}
+
+	memcpy(e->name, name, name_len + 1);
+	e->ref = (UniformRef) { .name = name };
+	uniform_ref_resolve(&e->ref, prog);
+
+	return e->ref.uniform;
+}
+
 void r_draw(VertexArray *varr, Primitive prim, uint firstvert, uint count, uint instances, uint base_instance) {
 	B.draw(varr, prim, firstvert, count, instances, base_instance);
 }
@@ -634,6 +699,18 @@ SDL_RWops* r_vertex_buffer_get_stream(VertexBuffer *vbuf) {
 	return B.vertex_buffer_get_stream(vbuf);
 }
 
+void r_vertex_buffer_resize(VertexBuffer *vbuf, size_t capacity) {
+	B.vertex_buffer_resize(vbuf, capacity);
+}
+
+void* r_vertex_buffer_map_write(VertexBuffer *vbuf, size_t *out_available) {
+	return B.vertex_buffer_map_write(vbuf, out_available);
+}
+
+void r_vertex_buffer_unmap_write(VertexBuffer *vbuf, size_t written) {
+	B.vertex_buffer_unmap_write(vbuf, written);
+}
+
 IndexBuffer* r_index_buffer_create(size_t max_elements) {
 	return B.index_buffer_create(max_elements);
 }
@@ -1029,7 +1106,7 @@ void _r_uniform_sampler_ptr(const char *uniform, Texture *tex) {
 
 void _r_uniform_ptr_sampler(Uniform *uniform, const char *tex) {
 	ASSERT_UTYPE_SAMPLER(uniform);
-	if(uniform) B.uniform(uniform, 0, 1, (Texture*[]) { res_texture(tex) });
+	if(uniform) B.uniform(uniform, 0, 1, (Texture*[]) { res_texture_cached(tex) });
 }
 
 void _r_uniform_sampler(const char *uniform, const char *tex) {
@@ -1052,7 +1129,7 @@ void _r_uniform_ptr_sampler_array(Uniform *uniform, uint offset, uint count, con
 		const char **vptr = values;
 
 		do {
-			*aptr++ = res_texture(*vptr++);
+			*aptr++ = res_texture_cached(*vptr++);
 		} while(aptr < aend);
 
 		B.uniform(uniform, 0, 1, arr);
@@ -552,6 +552,26 @@ ShaderProgram* r_shader_current(void) attr_returns_nonnull;
 
 Uniform* _r_shader_uniform(ShaderProgram *prog, const char *uniform_name, hash_t uniform_name_hash) attr_nonnull(1, 2);
 UniformType r_uniform_type(Uniform *uniform);
+
+// Like r_shader_current_uniform(), but goes through a small cache keyed by the address of [name]
+// and the current shader program first. This makes names that are string literals nearly free to
+// resolve. The contents are compared as well, so reused name buffers are fine.
+// The string-keyed r_uniform_* functions use this.
+Uniform* r_shader_current_uniform(const char *name) attr_nonnull(1);
+
+// A remembered uniform lookup, e.g. in a static variable. Resolved against the current shader
+// program, and only looked up again after a different program is bound or any program is destroyed.
+typedef struct UniformRef {
+	const char *name;
+	hash_t name_hash;
+	ShaderProgram *prog;
+	Uniform *uniform;
+	uint32_t generation;
+} UniformRef;
+
+#define UNIFORM_REF(_name) { .name = (_name) }
+
+Uniform* r_uniform_ref(UniformRef *ref) attr_nonnull(1);
 void r_uniform_ptr_unsafe(Uniform *uniform, uint offset, uint count, void *data);
 
 #define _R_UNIFORM_GENERIC(suffix, uniform, ...) (_Generic((uniform), \
@@ -772,6 +792,9 @@ void r_vertex_buffer_set_debug_label(VertexBuffer *vbuf, const char* label) attr
 void r_vertex_buffer_destroy(VertexBuffer *vbuf) attr_nonnull(1);
 void r_vertex_buffer_invalidate(VertexBuffer *vbuf) attr_nonnull(1);
 SDL_RWops* r_vertex_buffer_get_stream(VertexBuffer *vbuf) attr_nonnull(1);
+void r_vertex_buffer_resize(VertexBuffer *vbuf, size_t capacity) attr_nonnull(1);
+void* r_vertex_buffer_map_write(VertexBuffer *vbuf, size_t *out_available) attr_nonnull(1, 2) attr_returns_nonnull;
+void r_vertex_buffer_unmap_write(VertexBuffer *vbuf, size_t written) attr_nonnull(1);
 
 IndexBuffer* r_index_buffer_create(size_t max_elements);
 size_t r_index_buffer_get_capacity(IndexBuffer *ibuf) attr_nonnull(1);
@@ -859,6 +882,16 @@ void r_draw_sprite(const SpriteParams *params) attr_nonnull(1);
 void r_sprite_batch_prepare_state(const SpriteStateParams *stp);
 void r_sprite_batch_add_instance(const SpriteInstanceAttribs *attribs);
 
+/*
+ * Opt-in deferred batching: until r_sprite_batch_end_deferred(), sprites are bucketed by their
+ * batch state (textures, shader, blend mode, framebuffer, etc.) and emitted one bucket at a time,
+ * instead of flushing on every state change. This reorders sprites, so only use it for runs of
+ * sprites whose relative draw order doesn't matter. Shader uniforms other than the batch's own
+ * samplers must not change in between. Any non-sprite draw call emits pending sprites first.
+ */
+void r_sprite_batch_begin_deferred(void);
+void r_sprite_batch_end_deferred(void);
+
 void r_flush_sprites(void);
 
 BlendMode r_blend_compose(
@@ -948,7 +981,7 @@ void r_color3(float r, float g, float b) {
 
 INLINE attr_nonnull(1)
 void r_shader(const char *prog) {
-	r_shader_ptr(res_shader(prog));
+	r_shader_ptr(res_shader_cached(prog));
 }
 
 INLINE
@@ -956,11 +989,6 @@ Uniform* r_shader_uniform(ShaderProgram *prog, const char *name) {
 	return _r_shader_uniform(prog, name, ht_str2ptr_hash(name));
 }
 
-INLINE
-Uniform* r_shader_current_uniform(const char *name) {
-	return r_shader_uniform(r_shader_current(), name);
-}
-
 INLINE
 void r_clear(ClearBufferFlags flags, const Color *colorval, float depthval) {
 	r_framebuffer_clear(r_framebuffer_current(), flags, colorval, depthval);
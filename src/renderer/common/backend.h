@@ -100,6 +100,9 @@ typedef struct RendererFuncs {
 	void (*vertex_buffer_destroy)(VertexBuffer *vbuf);
 	void (*vertex_buffer_invalidate)(VertexBuffer *vbuf);
 	SDL_RWops* (*vertex_buffer_get_stream)(VertexBuffer *vbuf);
+	void (*vertex_buffer_resize)(VertexBuffer *vbuf, size_t capacity);
+	void* (*vertex_buffer_map_write)(VertexBuffer *vbuf, size_t *out_available);
+	void (*vertex_buffer_unmap_write)(VertexBuffer *vbuf, size_t written);
 
 	IndexBuffer* (*index_buffer_create)(size_t max_elements);
 	size_t (*index_buffer_get_capacity)(IndexBuffer *ibuf);
@@ -13,6 +13,7 @@
 #include "util/glm.h"
 #include "resource/sprite.h"
 #include "resource/model.h"
+#include "dynarray.h"
 
 #define SPRITE_BATCH_STATS 0
 
@@ -26,25 +27,69 @@
 
 #define SIZEOF_SPRITE_ATTRIBS (offsetof(SpriteInstanceAttribs, end_of_fields))
 
-static struct SpriteBatchState {
-	// constants (set once on init and not expected to change)
-	VertexArray *varr;
-	VertexBuffer *vbuf;
-	Model quad;
-	r_feature_bits_t renderer_features;
+// The instance buffer grows on demand up to this many sprites; beyond that, flushes are forced.
+#define SPRITE_BATCH_MIN_CAPACITY (1 << 11)
+#define SPRITE_BATCH_MAX_CAPACITY (1 << 15)
 
-	// varying state
+#define DEFERRED_NONE UINT_MAX
+
+// Everything that can't change within a single batch.
+// Always memset before filling in; deferred mode compares these with memcmp.
+typedef struct SpriteBatchStateKey {
 	mat4 projection;
 	Texture *primary_texture;
 	Texture *aux_textures[R_NUM_SPRITE_AUX_TEXTURES];
 	ShaderProgram *shader;
 	Framebuffer *framebuffer;
-	uint base_instance;
 	BlendMode blend;
 	CullFaceMode cull_mode;
 	DepthTestFunc depth_func;
-	uint num_pending;
 	r_capability_bits_t capbits;
+} SpriteBatchStateKey;
+
+typedef struct SpriteBatchDeferredInstance {
+	SpriteInstanceAttribs attribs;
+	uint next;
+} SpriteBatchDeferredInstance;
+
+typedef struct SpriteBatchDeferredBucket {
+	SpriteBatchStateKey key;
+	uint first;
+	uint last;
+} SpriteBatchDeferredBucket;
+
+// See r_sprite_batch_begin_deferred()
+typedef struct SpriteBatchDeferredState {
+	DYNAMIC_ARRAY(SpriteBatchDeferredBucket) buckets;
+	DYNAMIC_ARRAY(SpriteBatchDeferredInstance) instances;
+	int current_bucket;
+	int last_instance_bucket;
+	uint state_changes;
+	bool active;
+	bool emitting;
+} SpriteBatchDeferredState;
+
+static struct SpriteBatchState {
+	// constants (set once on init and not expected to change)
+	VertexArray *varr;
+	VertexBuffer *vbuf;
+	Model quad;
+	r_feature_bits_t renderer_features;
+
+	// varying state
+	SpriteBatchStateKey state;
+	uint base_instance;
+	uint num_pending;
+
+	// Window of the vertex buffer storage that instance attributes are written into directly.
+	// Committed to the buffer before drawing, see _r_sprite_batch_commit_writes().
+	struct {
+		char *begin;
+		char *ptr;
+		char *end;
+	} write_window;
+
+	SpriteBatchDeferredState deferred;
 
 #if SPRITE_BATCH_STATS
 	struct {
@@ -52,6 +97,7 @@ static struct SpriteBatchState {
 		uint sprites;
 		uint best_batch;
 		uint worst_batch;
+		uint flushes_saved;
 	} frame_stats;
 #endif
 } _r_sprite_batch;
@@ -92,7 +138,7 @@ void _r_sprite_batch_init(void) {
 	#undef VERTEX_OFS
 	#undef INSTANCE_OFS
 
-	uint capacity = 1 << 11;
+	uint capacity = SPRITE_BATCH_MIN_CAPACITY;
 
 	_r_sprite_batch.vbuf = r_vertex_buffer_create(sz_attr * capacity, NULL);
 	r_vertex_buffer_set_debug_label(_r_sprite_batch.vbuf, "Sprite batch vertex buffer");
@@ -114,11 +160,32 @@ void _r_sprite_batch_init(void) {
 }
 
 void _r_sprite_batch_shutdown(void) {
+	assert(!_r_sprite_batch.deferred.active);
+	dynarray_free_data(&_r_sprite_batch.deferred.buckets);
+	dynarray_free_data(&_r_sprite_batch.deferred.instances);
 	r_vertex_array_destroy(_r_sprite_batch.varr);
 	r_vertex_buffer_destroy(_r_sprite_batch.vbuf);
 }
 
+static void _r_sprite_batch_commit_writes(void) {
+	if(_r_sprite_batch.write_window.begin == NULL) {
+		return;
+	}
+
+	size_t written = _r_sprite_batch.write_window.ptr - _r_sprite_batch.write_window.begin;
+	r_vertex_buffer_unmap_write(_r_sprite_batch.vbuf, written);
+	memset(&_r_sprite_batch.write_window, 0, sizeof(_r_sprite_batch.write_window));
+}
+
+static void _r_sprite_batch_emit_deferred(void);
+
 void r_flush_sprites(void) {
+	if(_r_sprite_batch.deferred.instances.num_elements > 0 && !_r_sprite_batch.deferred.emitting) {
+		_r_sprite_batch_emit_deferred();
+	}
+
+	_r_sprite_batch_commit_writes();
+
 	if(_r_sprite_batch.num_pending == 0) {
 		return;
 	}
@@ -144,22 +211,24 @@ void r_flush_sprites(void) {
 	_r_sprite_batch.frame_stats.flushes++;
 #endif
 
+	SpriteBatchStateKey *state = &_r_sprite_batch.state;
+
 	r_state_push();
-	r_mat_proj_push_premade(_r_sprite_batch.projection);
+	r_mat_proj_push_premade(state->projection);
 
-	r_shader_ptr(NOT_NULL(_r_sprite_batch.shader));
-	r_uniform_sampler("tex", _r_sprite_batch.primary_texture);
-	r_uniform_sampler_array("tex_aux[0]", 0, R_NUM_SPRITE_AUX_TEXTURES, _r_sprite_batch.aux_textures);
-	r_framebuffer(_r_sprite_batch.framebuffer);
-	r_blend(_r_sprite_batch.blend);
-	r_capabilities(_r_sprite_batch.capbits);
+	r_shader_ptr(NOT_NULL(state->shader));
+	r_uniform_sampler("tex", state->primary_texture);
+	r_uniform_sampler_array("tex_aux[0]", 0, R_NUM_SPRITE_AUX_TEXTURES, state->aux_textures);
+	r_framebuffer(state->framebuffer);
+	r_blend(state->blend);
+	r_capabilities(state->capbits);
 
-	if(_r_sprite_batch.capbits & r_capability_bit(RCAP_DEPTH_TEST)) {
-		r_depth_func(_r_sprite_batch.depth_func);
+	if(state->capbits & r_capability_bit(RCAP_DEPTH_TEST)) {
+		r_depth_func(state->depth_func);
 	}
 
-	if(_r_sprite_batch.capbits & r_capability_bit(RCAP_CULL_FACE)) {
-		r_cull(_r_sprite_batch.cull_mode);
+	if(state->capbits & r_capability_bit(RCAP_CULL_FACE)) {
+		r_cull(state->cull_mode);
 	}
 
 	r_draw_model_ptr(&_r_sprite_batch.quad, pending, 0);
@@ -251,7 +320,7 @@ INLINE void _r_sprite_batch_process_params(
 	assert(!(sprite_params->sprite && sprite_params->sprite_ptr));
 
 	if((*sprite = sprite_params->sprite_ptr) == NULL) {
-		*sprite = res_sprite(NOT_NULL(sprite_params->sprite));
+		*sprite = res_sprite_cached(NOT_NULL(sprite_params->sprite));
 	}
 
 	state_params->primary_texture = (*sprite)->tex;
@@ -264,100 +333,256 @@ INLINE void _r_sprite_batch_process_params(
 
 	if((state_params->shader = sprite_params->shader_ptr) == NULL) {
 		if(sprite_params->shader != NULL) {
-			state_params->shader = res_shader(sprite_params->shader);
+			state_params->shader = res_shader_cached(sprite_params->shader);
 		} else {
 			state_params->shader = r_shader_current();
 		}
 	}
 }
 
-void r_sprite_batch_prepare_state(const SpriteStateParams *stp) {
-	if(stp->primary_texture != _r_sprite_batch.primary_texture) {
+static void _r_sprite_batch_make_state_key(const SpriteStateParams *stp, SpriteBatchStateKey *key) {
+	memset(key, 0, sizeof(*key));
+
+	assume(stp->shader != NULL);
+
+	key->primary_texture = stp->primary_texture;
+	memcpy(key->aux_textures, stp->aux_textures, sizeof(key->aux_textures));
+	key->shader = stp->shader;
+	key->blend = stp->blend;
+	key->framebuffer = r_framebuffer_current();
+	key->capbits = r_capabilities_current();
+
+	if(key->capbits & r_capability_bit(RCAP_DEPTH_TEST)) {
+		key->depth_func = r_depth_func_current();
+	}
+
+	if(key->capbits & r_capability_bit(RCAP_CULL_FACE)) {
+		key->cull_mode = r_cull_current();
+	}
+
+	glm_mat4_copy(*r_mat_proj_current_ptr(), key->projection);
+}
+
+static void _r_sprite_batch_apply_state(const SpriteBatchStateKey *key) {
+	SpriteBatchStateKey *state = &_r_sprite_batch.state;
+
+	if(key->primary_texture != state->primary_texture) {
 		r_flush_sprites();
-		_r_sprite_batch.primary_texture = stp->primary_texture;
+		state->primary_texture = key->primary_texture;
 	}
 
 	for(uint i = 0; i < R_NUM_SPRITE_AUX_TEXTURES; ++i) {
-		Texture *aux_tex = stp->aux_textures[i];
+		Texture *aux_tex = key->aux_textures[i];
 
-		if(aux_tex != NULL && aux_tex != _r_sprite_batch.aux_textures[i]) {
+		if(aux_tex != NULL && aux_tex != state->aux_textures[i]) {
 			r_flush_sprites();
-			_r_sprite_batch.aux_textures[i] = aux_tex;
+			state->aux_textures[i] = aux_tex;
 		}
 	}
 
-	assume(stp->shader != NULL);
-
-	if(stp->shader != _r_sprite_batch.shader) {
+	if(key->shader != state->shader) {
 		r_flush_sprites();
-		_r_sprite_batch.shader = stp->shader;
+		state->shader = key->shader;
 	}
 
-	BlendMode blend = stp->blend;
+	if(key->blend != state->blend) {
+		r_flush_sprites();
+		state->blend = key->blend;
+	}
 
-	if(blend != _r_sprite_batch.blend) {
+	if(key->framebuffer != state->framebuffer) {
 		r_flush_sprites();
-		_r_sprite_batch.blend = blend;
+		state->framebuffer = key->framebuffer;
 	}
 
-	Framebuffer *fb = r_framebuffer_current();
+	r_capability_bits_t caps = key->capbits;
 
-	if(fb != _r_sprite_batch.framebuffer) {
+	if(state->capbits != caps) {
 		r_flush_sprites();
-		_r_sprite_batch.framebuffer = fb;
+		state->capbits = caps;
 	}
 
-	r_capability_bits_t caps = r_capabilities_current();
-	DepthTestFunc depth_func = r_depth_func_current();
-	CullFaceMode cull_mode = r_cull_current();
-
-	if(_r_sprite_batch.capbits != caps) {
+	if((caps & r_capability_bit(RCAP_DEPTH_TEST)) && state->depth_func != key->depth_func) {
 		r_flush_sprites();
-		_r_sprite_batch.capbits = caps;
+		state->depth_func = key->depth_func;
 	}
 
-	if((caps & r_capability_bit(RCAP_DEPTH_TEST)) && _r_sprite_batch.depth_func != depth_func) {
+	if((caps & r_capability_bit(RCAP_CULL_FACE)) && state->cull_mode != key->cull_mode) {
 		r_flush_sprites();
-		_r_sprite_batch.depth_func = depth_func;
+		state->cull_mode = key->cull_mode;
 	}
 
-	if((caps & r_capability_bit(RCAP_CULL_FACE)) && _r_sprite_batch.cull_mode != cull_mode) {
+	if(memcmp(key->projection, state->projection, sizeof(mat4))) {
 		r_flush_sprites();
-		_r_sprite_batch.cull_mode = cull_mode;
+		glm_mat4_copy((vec4*)key->projection, state->projection);
 	}
+}
 
-	mat4 *current_projection = r_mat_proj_current_ptr();
+static void _r_sprite_batch_defer_state(const SpriteBatchStateKey *key) {
+	SpriteBatchDeferredState *deferred = &_r_sprite_batch.deferred;
 
-	if(memcmp(*current_projection, _r_sprite_batch.projection, sizeof(mat4))) {
-		r_flush_sprites();
-		glm_mat4_copy(*current_projection, _r_sprite_batch.projection);
+	if(
+		deferred->current_bucket >= 0 &&
+		!memcmp(&dynarray_get(&deferred->buckets, deferred->current_bucket).key, key, sizeof(*key))
+	) {
+		return;
 	}
+
+	dynarray_foreach(&deferred->buckets, int i, SpriteBatchDeferredBucket *bucket, {
+		if(!memcmp(&bucket->key, key, sizeof(*key))) {
+			deferred->current_bucket = i;
+			return;
+		}
+	});
+
+	SpriteBatchDeferredBucket *bucket = dynarray_append(&deferred->buckets);
+	bucket->key = *key;
+	bucket->first = bucket->last = DEFERRED_NONE;
+	deferred->current_bucket = deferred->buckets.num_elements - 1;
 }
 
-static SDL_RWops *_r_sprite_batch_prepare_buffer(void) {
-	SDL_RWops *stream = r_vertex_buffer_get_stream(_r_sprite_batch.vbuf);
-	size_t remaining = SDL_RWsize(stream) - SDL_RWtell(stream);
+void r_sprite_batch_prepare_state(const SpriteStateParams *stp) {
+	SpriteBatchStateKey key;
+	_r_sprite_batch_make_state_key(stp, &key);
 
-	if(remaining < SIZEOF_SPRITE_ATTRIBS) {
-		// TODO: maybe it is better to grow the buffer instead?
-		log_warn("Vertex buffer exhausted (%zu needed for next sprite, %zu remaining), flush forced", SIZEOF_SPRITE_ATTRIBS, remaining);
-		r_flush_sprites();
+	if(_r_sprite_batch.deferred.active) {
+		_r_sprite_batch_defer_state(&key);
+	} else {
+		_r_sprite_batch_apply_state(&key);
+	}
+}
+
+static void _r_sprite_batch_map_buffer(void) {
+	VertexBuffer *vbuf = _r_sprite_batch.vbuf;
+	size_t available;
+
+	_r_sprite_batch_commit_writes();
+	char *buf = r_vertex_buffer_map_write(vbuf, &available);
+
+	if(available < SIZEOF_SPRITE_ATTRIBS) {
+		size_t capacity = SDL_RWsize(r_vertex_buffer_get_stream(vbuf));
+
+		if(capacity < SIZEOF_SPRITE_ATTRIBS * SPRITE_BATCH_MAX_CAPACITY) {
+			r_vertex_buffer_resize(vbuf, capacity * 2);
+		} else {
+			log_warn("Vertex buffer exhausted (%zu needed for next sprite, %zu remaining), flush forced", SIZEOF_SPRITE_ATTRIBS, available);
+			r_flush_sprites();
+		}
+
+		buf = r_vertex_buffer_map_write(vbuf, &available);
+		assert(available >= SIZEOF_SPRITE_ATTRIBS);
 	}
 
-	return stream;
+	_r_sprite_batch.write_window.begin = buf;
+	_r_sprite_batch.write_window.ptr = buf;
+	_r_sprite_batch.write_window.end = buf + available;
 }
 
-void r_sprite_batch_add_instance(const SpriteInstanceAttribs *attribs) {
-	SDL_RWops *stream = _r_sprite_batch_prepare_buffer();
-	SDL_RWwrite(stream, attribs, SIZEOF_SPRITE_ATTRIBS, 1);
+static void _r_sprite_batch_add_instance_immediate(const SpriteInstanceAttribs *attribs) {
+	if(UNLIKELY((size_t)(_r_sprite_batch.write_window.end - _r_sprite_batch.write_window.ptr) < SIZEOF_SPRITE_ATTRIBS)) {
+		_r_sprite_batch_map_buffer();
+	}
 
+	memcpy(_r_sprite_batch.write_window.ptr, attribs, SIZEOF_SPRITE_ATTRIBS);
+	_r_sprite_batch.write_window.ptr += SIZEOF_SPRITE_ATTRIBS;
 	_r_sprite_batch.num_pending++;
+}
+
+static void _r_sprite_batch_add_instance_deferred(const SpriteInstanceAttribs *attribs) {
+	SpriteBatchDeferredState *deferred = &_r_sprite_batch.deferred;
+	int bucket_idx = deferred->current_bucket;
+	assert(bucket_idx >= 0);
+
+	if(bucket_idx != deferred->last_instance_bucket) {
+		// Would have been a flush in immediate mode
+		deferred->state_changes++;
+		deferred->last_instance_bucket = bucket_idx;
+	}
+
+	uint instance_idx = deferred->instances.num_elements;
+	SpriteBatchDeferredInstance *instance = dynarray_append(&deferred->instances);
+	memcpy(&instance->attribs, attribs, SIZEOF_SPRITE_ATTRIBS);
+	instance->next = DEFERRED_NONE;
+
+	SpriteBatchDeferredBucket *bucket = dynarray_get_ptr(&deferred->buckets, bucket_idx);
+
+	if(bucket->last == DEFERRED_NONE) {
+		bucket->first = instance_idx;
+	} else {
+		dynarray_get(&deferred->instances, bucket->last).next = instance_idx;
+	}
+
+	bucket->last = instance_idx;
+}
+
+void r_sprite_batch_add_instance(const SpriteInstanceAttribs *attribs) {
+	if(_r_sprite_batch.deferred.active && !_r_sprite_batch.deferred.emitting) {
+		_r_sprite_batch_add_instance_deferred(attribs);
+	} else {
+		_r_sprite_batch_add_instance_immediate(attribs);
+	}
 
 #if SPRITE_BATCH_STATS
 	_r_sprite_batch.frame_stats.sprites++;
 #endif
 }
 
+static void _r_sprite_batch_emit_deferred(void) {
+	SpriteBatchDeferredState *deferred = &_r_sprite_batch.deferred;
+	attr_unused uint num_batches = 0;
+
+	deferred->emitting = true;
+
+	dynarray_foreach_elem(&deferred->buckets, SpriteBatchDeferredBucket *bucket, {
+		if(bucket->first == DEFERRED_NONE) {
+			continue;
+		}
+
+		_r_sprite_batch_apply_state(&bucket->key);
+
+		for(uint i = bucket->first; i != DEFERRED_NONE;) {
+			SpriteBatchDeferredInstance *instance = dynarray_get_ptr(&deferred->instances, i);
+			_r_sprite_batch_add_instance_immediate(&instance->attribs);
+			i = instance->next;
+		}
+
+		bucket->first = bucket->last = DEFERRED_NONE;
+		++num_batches;
+	});
+
+#if SPRITE_BATCH_STATS
+	_r_sprite_batch.frame_stats.flushes_saved += deferred->state_changes - num_batches;
+#endif
+
+	// Keep the buckets around: the current state may still be in use after a mid-pass flush.
+	deferred->instances.num_elements = 0;
+	deferred->last_instance_bucket = -1;
+	deferred->state_changes = 0;
+	deferred->emitting = false;
+}
+
+void r_sprite_batch_begin_deferred(void) {
+	SpriteBatchDeferredState *deferred = &_r_sprite_batch.deferred;
+	assert(!deferred->active);
+	assert(deferred->instances.num_elements == 0);
+
+	deferred->active = true;
+	deferred->current_bucket = -1;
+	deferred->last_instance_bucket = -1;
+	deferred->buckets.num_elements = 0;
+}
+
+void r_sprite_batch_end_deferred(void) {
+	SpriteBatchDeferredState *deferred = &_r_sprite_batch.deferred;
+	assert(deferred->active);
+
+	if(deferred->instances.num_elements > 0) {
+		_r_sprite_batch_emit_deferred();
+	}
+
+	deferred->active = false;
+}
+
 void r_draw_sprite(const SpriteParams *params) {
 	SpriteStateParams state_params;
 	SpriteInstanceAttribs attribs;
@@ -375,6 +600,7 @@ void r_draw_sprite(const SpriteParams *params) {
 #endif
 
 void _r_sprite_batch_end_frame(void) {
+	assert(!_r_sprite_batch.deferred.active);
 	r_flush_sprites();
 
 #if SPRITE_BATCH_STATS
@@ -383,9 +609,10 @@ void _r_sprite_batch_end_frame(void) {
 	}
 
 	static char buf[512];
-	snprintf(buf, sizeof(buf), "%6i sprites %6i flushes %9.02f spr/flush %6i best %6i worst %12.02f fps",
+	snprintf(buf, sizeof(buf), "%6i sprites %6i flushes %6i saved %9.02f spr/flush %6i best %6i worst %12.02f fps",
 		_r_sprite_batch.frame_stats.sprites,
 		_r_sprite_batch.frame_stats.flushes,
+		_r_sprite_batch.frame_stats.flushes_saved,
 		_r_sprite_batch.frame_stats.sprites / (double)_r_sprite_batch.frame_stats.flushes,
 		_r_sprite_batch.frame_stats.best_batch,
 		_r_sprite_batch.frame_stats.worst_batch,
@@ -405,13 +632,13 @@ void _r_sprite_batch_end_frame(void) {
 }
 
 void _r_sprite_batch_texture_deleted(Texture *tex) {
-	if(_r_sprite_batch.primary_texture == tex) {
-		_r_sprite_batch.primary_texture = NULL;
+	if(_r_sprite_batch.state.primary_texture == tex) {
+		_r_sprite_batch.state.primary_texture = NULL;
 	}
 
 	for(uint i = 0; i < R_NUM_SPRITE_AUX_TEXTURES; ++i) {
-		if(_r_sprite_batch.aux_textures[i] == tex) {
-			_r_sprite_batch.aux_textures[i] = NULL;
+		if(_r_sprite_batch.state.aux_textures[i] == tex) {
+			_r_sprite_batch.state.aux_textures[i] = NULL;
 		}
 	}
 }
@@ -70,6 +70,22 @@ SDL_RWops* gl33_buffer_get_stream(CommonBuffer *cbuf) {
 	return &cbuf->stream;
 }
 
+void* gl33_buffer_map_write(CommonBuffer *cbuf, size_t *out_available) {
+	assert(cbuf->offset <= cbuf->size);
+	*out_available = cbuf->size - cbuf->offset;
+	return cbuf->cache.buffer + cbuf->offset;
+}
+
+void gl33_buffer_unmap_write(CommonBuffer *cbuf, size_t written) {
+	assert(cbuf->offset + written <= cbuf->size);
+
+	if(written > 0) {
+		cbuf->cache.update_begin = umin(cbuf->offset, cbuf->cache.update_begin);
+		cbuf->cache.update_end = umax(cbuf->offset + written, cbuf->cache.update_end);
+		cbuf->offset += written;
+	}
+}
+
 CommonBuffer* gl33_buffer_create(uint bindidx, size_t alloc_size) {
 	CommonBuffer *cbuf = calloc(1, alloc_size);
 
@@ -137,3 +153,30 @@ void gl33_buffer_flush(CommonBuffer *cbuf) {
 	cbuf->cache.update_begin = cbuf->size;
 	cbuf->cache.update_end = 0;
 }
+
+void gl33_buffer_resize(CommonBuffer *cbuf, size_t new_size) {
+	new_size = topow2(new_size);
+	size_t old_size = cbuf->size;
+
+	if(new_size == old_size) {
+		return;
+	}
+
+	assert(cbuf->offset <= new_size);
+
+	cbuf->cache.buffer = realloc(cbuf->cache.buffer, new_size);
+
+	if(new_size > old_size) {
+		memset(cbuf->cache.buffer + old_size, 0, new_size - old_size);
+	}
+
+	cbuf->size = new_size;
+
+	GL33_BUFFER_TEMP_BIND(cbuf, {
+		glBufferData(gl33_bindidx_to_glenum(cbuf->bindidx), cbuf->size, NULL, GL_DYNAMIC_DRAW);
+	});
+
+	// The old storage has been orphaned, so everything has to be uploaded again.
+	cbuf->cache.update_begin = 0;
+	cbuf->cache.update_end = umin(old_size, new_size);
+}
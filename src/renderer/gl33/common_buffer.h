@@ -51,6 +51,9 @@ void gl33_buffer_destroy(CommonBuffer *cbuf);
 void gl33_buffer_invalidate(CommonBuffer *cbuf);
 SDL_RWops* gl33_buffer_get_stream(CommonBuffer *cbuf);
 void gl33_buffer_flush(CommonBuffer *cbuf);
+void gl33_buffer_resize(CommonBuffer *cbuf, size_t new_size);
+void* gl33_buffer_map_write(CommonBuffer *cbuf, size_t *out_available);
+void gl33_buffer_unmap_write(CommonBuffer *cbuf, size_t written);
 
 #define GL33_BUFFER_TEMP_BIND(cbuf, code) do { \
 	CommonBuffer *_tempbind_cbuf = (cbuf); \
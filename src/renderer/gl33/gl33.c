@@ -21,6 +21,7 @@
 #include "vertex_buffer.h"
 #include "index_buffer.h"
 #include "vertex_array.h"
+#include "program_cache.h"
 #include "../glcommon/debug.h"
 #include "../glcommon/vtable.h"
 #include "resource/resource.h"
@@ -51,6 +52,7 @@ static struct {
 		TextureUnit *active;
 		TextureUnit *pending;
 		GLint limit;
+		uint32_t generation;
 	} texunits;
 
 	struct {
@@ -276,6 +278,7 @@ static void gl33_init_context(SDL_Window *window) {
 		glcommon_debug_enable();
 	}
 
+	gl33_program_cache_init();
 	gl33_init_texunits();
 	gl33_set_clear_depth(1);
 	gl33_set_clear_color(RGBA(0, 0, 0, 0));
@@ -627,8 +630,9 @@ static void gl33_set_texunit_binding(TextureUnit *unit, Texture *tex, GLuint loc
 	}
 
 	if(unit->pending == tex) {
-		if(tex) {
+		if(tex && tex->binding_unit != unit) {
 			tex->binding_unit = unit;
+			++R.texunits.generation;
 		}
 
 		if(lock_target) {
@@ -650,6 +654,7 @@ static void gl33_set_texunit_binding(TextureUnit *unit, Texture *tex, GLuint loc
 	}
 
 	unit->pending = tex;
+	++R.texunits.generation;
 
 	if(tex) {
 		tex->binding_unit = unit;
@@ -877,6 +882,10 @@ void gl33_sync_blend_mode(void) {
 	}
 }
 
+uint32_t gl33_texunits_generation(void) {
+	return R.texunits.generation;
+}
+
 static TextureUnit *gl33_get_free_texunit(void) {
 	TextureUnit *u = R.texunits.list.first;
 
@@ -983,6 +992,7 @@ void gl33_texture_deleted(Texture *tex) {
 		if(unit->pending == tex) {
 			unit->pending = NULL;
 			unit->locked_for_target = 0;
+			++R.texunits.generation;
 			bump = true;
 		}
 
@@ -1094,6 +1104,7 @@ static void gl33_post_init(void) {
 }
 
 static void gl33_shutdown(void) {
+	gl33_program_cache_shutdown();
 	glcommon_unload_library();
 	SDL_GL_DeleteContext(R.gl_context);
 }
@@ -1406,6 +1417,9 @@ RendererBackend _r_backend_gl33 = {
 		.vertex_buffer_destroy = gl33_vertex_buffer_destroy,
 		.vertex_buffer_invalidate = gl33_vertex_buffer_invalidate,
 		.vertex_buffer_get_stream = gl33_vertex_buffer_get_stream,
+		.vertex_buffer_resize = gl33_vertex_buffer_resize,
+		.vertex_buffer_map_write = gl33_vertex_buffer_map_write,
+		.vertex_buffer_unmap_write = gl33_vertex_buffer_unmap_write,
 		.index_buffer_create = gl33_index_buffer_create,
 		.index_buffer_get_capacity = gl33_index_buffer_get_capacity,
 		.index_buffer_get_debug_label = gl33_index_buffer_get_debug_label,
@@ -57,6 +57,10 @@ void gl33_end_draw(void *state);
 // Returns the numeric ID of the choosen texturing unit.
 uint gl33_bind_texture(Texture *texture, GLuint lock_target, int preferred_unit);
 
+// Incremented whenever a texture is bound to, or evicted from, a texturing unit.
+// If it hasn't changed, every texture is still where gl33_bind_texture last put it.
+uint32_t gl33_texunits_generation(void);
+
 void gl33_bind_vao(GLuint vao);
 void gl33_sync_vao(void);
 GLuint gl33_vao_current(void);
@@ -0,0 +1,236 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "program_cache.h"
+#include "shader_object.h"
+
+#include "util.h"
+#include "util/cache_entry.h"
+
+#define CACHE_VERSION 1
+#define CACHE_MAGIC 0x504C4754  // 'TGLP'
+
+enum {
+	ENTRY_PATH_SIZE = 128,
+};
+
+static struct {
+	GLint *formats;
+	GLint num_formats;
+	uint8_t driver_hash[SHA256_BLOCK_SIZE];
+	bool enabled;
+} pcache;
+
+void gl33_program_cache_init(void) {
+	if(!env_get("TAISEI_GL_PROGRAM_CACHE", true)) {
+		log_info("Program binary cache disabled by environment");
+		return;
+	}
+
+	if(!glext.get_program_binary) {
+		log_info("Program binaries not supported, cache disabled");
+		return;
+	}
+
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &pcache.num_formats);
+
+	if(pcache.num_formats <= 0) {
+		log_info("No program binary formats supported, cache disabled");
+		pcache.num_formats = 0;
+		return;
+	}
+
+	pcache.formats = calloc(pcache.num_formats, sizeof(*pcache.formats));
+	glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, pcache.formats);
+
+	static const GLenum driver_strings[] = {
+		GL_VENDOR,
+		GL_RENDERER,
+		GL_VERSION,
+		GL_SHADING_LANGUAGE_VERSION,
+	};
+
+	SHA256State *sha256 = sha256_new();
+
+	for(uint i = 0; i < ARRAY_SIZE(driver_strings); ++i) {
+		const char *str = (const char*)glGetString(driver_strings[i]);
+
+		if(str == NULL) {
+			str = "";
+		}
+
+		sha256_update(sha256, (const uint8_t*)str, strlen(str) + 1);
+	}
+
+	sha256_final(sha256, pcache.driver_hash, sizeof(pcache.driver_hash));
+	sha256_free(sha256);
+
+	pcache.enabled = true;
+}
+
+void gl33_program_cache_shutdown(void) {
+	free(pcache.formats);
+	memset(&pcache, 0, sizeof(pcache));
+}
+
+bool gl33_program_cache_key(uint num_objects, ShaderObject *shobjs[num_objects], size_t bufsize, char buf[bufsize]) {
+	assert(bufsize >= GL33_PROGRAM_CACHE_KEY_SIZE);
+
+	if(!pcache.enabled) {
+		return false;
+	}
+
+	SHA256State *sha256 = sha256_new();
+	sha256_update(sha256, pcache.driver_hash, sizeof(pcache.driver_hash));
+
+	for(uint i = 0; i < num_objects; ++i) {
+		ShaderObject *shobj = shobjs[i];
+		uint8_t stage = shobj->stage;
+
+		sha256_update(sha256, &stage, sizeof(stage));
+		sha256_update(sha256, shobj->source_hash, sizeof(shobj->source_hash));
+
+		for(uint a = 0; a < shobj->num_attribs; ++a) {
+			GLSLAttribute *attr = shobj->attribs + a;
+			uint8_t location[4];
+			location[0] = attr->location;
+			location[1] = attr->location >> 8;
+			location[2] = attr->location >> 16;
+			location[3] = attr->location >> 24;
+
+			sha256_update(sha256, (const uint8_t*)attr->name, strlen(attr->name) + 1);
+			sha256_update(sha256, location, sizeof(location));
+		}
+	}
+
+	uint8_t digest[SHA256_BLOCK_SIZE];
+	sha256_final(sha256, digest, sizeof(digest));
+	sha256_free(sha256);
+	hexdigest(digest, sizeof(digest), buf, bufsize);
+
+	return true;
+}
+
+static bool program_cache_make_path(const char *key, size_t bufsize, char buf[bufsize]) {
+	int len = snprintf(buf, bufsize, "cache/glprogram/%s", key);
+
+	if(len >= bufsize) {
+		log_error("Cache entry name is too long");
+		return false;
+	}
+
+	return true;
+}
+
+static bool program_cache_format_supported(GLenum format) {
+	for(GLint i = 0; i < pcache.num_formats; ++i) {
+		if(pcache.formats[i] == format) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+GLuint gl33_program_cache_load(const char *key) {
+	char path[ENTRY_PATH_SIZE];
+	CacheEntry entry;
+
+	if(
+		!pcache.enabled ||
+		!program_cache_make_path(key, sizeof(path), path) ||
+		!cache_entry_open_read(&entry, path, CACHE_MAGIC, CACHE_VERSION)
+	) {
+		return 0;
+	}
+
+	void *binary = NULL;
+	GLuint program = 0;
+
+	GLenum format = SDL_ReadLE32(entry.rw);
+	uint32_t binary_size = SDL_ReadLE32(entry.rw);
+
+	if(binary_size == 0 || binary_size > INT32_MAX) {
+		log_error("%s: Bad cache entry: unexpected size", path);
+		goto done;
+	}
+
+	if(!cache_entry_expect_payload(&entry, binary_size)) {
+		goto done;
+	}
+
+	if(!program_cache_format_supported(format)) {
+		log_warn("%s: Binary format 0x%04x is not supported by the driver", path, format);
+		goto done;
+	}
+
+	binary = malloc(binary_size);
+
+	if(!cache_entry_read_payload(&entry, binary_size, binary)) {
+		goto done;
+	}
+
+	program = glCreateProgram();
+	glProgramBinary(program, format, binary, binary_size);
+
+	GLint link_status;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+
+	if(!link_status) {
+		// Most likely the driver has been updated without changing its version string.
+		log_warn("%s: Program binary rejected by the driver, will rebuild from source", path);
+		glDeleteProgram(program);
+		program = 0;
+	}
+
+done:
+	free(binary);
+	cache_entry_close(&entry);
+	return program;
+}
+
+void gl33_program_cache_prepare_link(GLuint program) {
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void gl33_program_cache_store(const char *key, GLuint program) {
+	char path[ENTRY_PATH_SIZE];
+
+	if(!pcache.enabled || !program_cache_make_path(key, sizeof(path), path)) {
+		return;
+	}
+
+	GLint binary_size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+
+	if(binary_size <= 0) {
+		return;
+	}
+
+	void *binary = malloc(binary_size);
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, binary_size, &written, &format, binary);
+
+	if(written <= 0) {
+		free(binary);
+		return;
+	}
+
+	CacheEntry entry;
+
+	if(cache_entry_open_write(&entry, path, CACHE_MAGIC, CACHE_VERSION)) {
+		SDL_WriteLE32(entry.rw, format);
+		SDL_WriteLE32(entry.rw, written);
+		cache_entry_finish_write(&entry, written, binary);
+	}
+
+	free(binary);
+}
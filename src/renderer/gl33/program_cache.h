@@ -0,0 +1,50 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#ifndef IGUARD_renderer_gl33_program_cache_h
+#define IGUARD_renderer_gl33_program_cache_h
+
+#include "taisei.h"
+
+#include "../api.h"
+#include "opengl.h"
+#include "util/sha256.h"
+
+/*
+ * On-disk cache of linked program binaries, as returned by glGetProgramBinary.
+ * Entries are keyed by the driver identification strings, the sources of the shader objects,
+ * and the attribute bindings. Any mismatch simply results in a cache miss; programs that the
+ * driver refuses to load are rebuilt from source by the caller.
+ */
+
+#define GL33_PROGRAM_CACHE_KEY_SIZE SHA256_HEXDIGEST_SIZE
+
+void gl33_program_cache_init(void);
+void gl33_program_cache_shutdown(void);
+
+/*
+ * Returns false if the cache is not available.
+ */
+bool gl33_program_cache_key(uint num_objects, ShaderObject *shobjs[num_objects], size_t bufsize, char buf[bufsize])
+	attr_nonnull_all;
+
+/*
+ * Returns a new, linked program object, or 0 on cache miss.
+ */
+GLuint gl33_program_cache_load(const char *key)
+	attr_nonnull_all;
+
+/*
+ * Must be called before linking a program that is going to be stored in the cache.
+ */
+void gl33_program_cache_prepare_link(GLuint program);
+
+void gl33_program_cache_store(const char *key, GLuint program)
+	attr_nonnull_all;
+
+#endif // IGUARD_renderer_gl33_program_cache_h
@@ -104,6 +104,7 @@ ShaderObject* gl33_shader_object_compile(ShaderSource *source) {
 		shobj->gl_handle = gl_handle;
 		shobj->stage = source->stage;
 		shobj->num_attribs = nattribs;
+		sha256_digest((uint8_t*)source->content, source->content_size, shobj->source_hash, sizeof(shobj->source_hash));
 		snprintf(shobj->debug_label, sizeof(shobj->debug_label), "Shader object #%i", gl_handle);
 
 		for(uint i = 0; i < nattribs; ++i) {
@@ -13,10 +13,12 @@
 
 #include "resource/shader_object.h"
 #include "opengl.h"
+#include "util/sha256.h"
 
 struct ShaderObject {
 	GLuint gl_handle;
 	ShaderStage stage;
+	uint8_t source_hash[SHA256_BLOCK_SIZE];  // for the program binary cache
 	char debug_label[R_DEBUG_LABEL_SIZE];
 	uint num_attribs;
 	GLSLAttribute attribs[];
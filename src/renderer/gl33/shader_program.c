@@ -12,6 +12,7 @@
 #include "shader_program.h"
 #include "shader_object.h"
 #include "texture.h"
+#include "program_cache.h"
 #include "../glcommon/debug.h"
 #include "../api.h"
 
@@ -189,6 +190,12 @@ static void gl33_update_uniform(Uniform *uniform, uint offset, uint count, const
 	if(idx_last > uniform->cache.update_last_idx) {
 		uniform->cache.update_last_idx = idx_last;
 	}
+
+	if(!uniform->dirty) {
+		uniform->dirty = true;
+		uniform->dirty_next = uniform->prog->dirty_uniforms;
+		uniform->prog->dirty_uniforms = uniform;
+	}
 }
 
 static void gl33_commit_uniform(Uniform *uniform) {
@@ -229,45 +236,79 @@ static GLuint get_texture_target(Texture *tex, UniformType utype) {
 	}
 }
 
-static void *gl33_sync_uniform(const char *key, void *value, void *arg) {
-	Uniform *uniform = value;
-
+static void gl33_sync_sampler(Uniform *uniform) {
 	// special case: for sampler uniforms, we have to construct the actual data from the texture pointers array.
 	UniformType utype = uniform->type;
-	if(UNIFORM_TYPE_IS_SAMPLER(utype)) {
-		Uniform *size_uniform = uniform->size_uniform;
+	Uniform *size_uniform = uniform->size_uniform;
 
-		for(uint i = 0; i < uniform->array_size; ++i) {
-			Texture *tex = uniform->textures[i];
-			GLuint preferred_unit = CASTPTR_ASSUME_ALIGNED(uniform->cache.pending, int)[i];
-			GLuint unit = gl33_bind_texture(tex, get_texture_target(tex, utype), preferred_unit);
+	for(uint i = 0; i < uniform->array_size; ++i) {
+		Texture *tex = uniform->textures[i];
+		GLuint preferred_unit = CASTPTR_ASSUME_ALIGNED(uniform->cache.pending, int)[i];
+		GLuint unit = gl33_bind_texture(tex, get_texture_target(tex, utype), preferred_unit);
+
+		if(unit != preferred_unit) {
+			gl33_update_uniform(uniform, i, 1, &unit);
+		}
 
-			if(unit != preferred_unit) {
-				gl33_update_uniform(uniform, i, 1, &unit);
+		if(size_uniform) {
+			uint w, h;
+
+			if(tex) {
+				r_texture_get_size(tex, 0, &w, &h);
+			} else {
+				w = h = 0;
 			}
 
-			if(size_uniform) {
-				uint w, h;
+			vec2_noalign size = { w, h };
+			gl33_update_uniform(size_uniform, i, 1, &size);
+		}
+	}
+}
 
-				if(tex) {
-					r_texture_get_size(tex, 0, &w, &h);
-				} else {
-					w = h = 0;
-				}
+static void gl33_sync_samplers(ShaderProgram *prog) {
+	if(prog->samplers_dirty || prog->samplers_texunits_generation != gl33_texunits_generation()) {
+		dynarray_foreach_elem(&prog->samplers, Uniform **uniform, {
+			gl33_sync_sampler(*uniform);
+		});
 
-				vec2_noalign size = { w, h };
-				gl33_update_uniform(size_uniform, i, 1, &size);
-				gl33_commit_uniform(size_uniform);
+		prog->samplers_dirty = false;
+		prog->samplers_texunits_generation = gl33_texunits_generation();
+		return;
+	}
+
+	// Every texture is still bound where we left it, so there is nothing to rebind. The units only
+	// have to be locked for textures that need to be prepared (e.g. have their mipmaps regenerated)
+	// before rendering. This doesn't move anything, so the generation stays the same.
+	dynarray_foreach_elem(&prog->samplers, Uniform **puniform, {
+		Uniform *uniform = *puniform;
+
+		for(uint i = 0; i < uniform->array_size; ++i) {
+			Texture *tex = uniform->textures[i];
+
+			if(tex && tex->mipmaps_outdated) {
+				GLuint unit = CASTPTR_ASSUME_ALIGNED(uniform->cache.pending, int)[i];
+				attr_unused GLuint new_unit = gl33_bind_texture(tex, tex->bind_target, unit);
+				assert(new_unit == unit);
 			}
 		}
-	}
+	});
 
-	gl33_commit_uniform(uniform);
-	return NULL;
+	assert(prog->samplers_texunits_generation == gl33_texunits_generation());
 }
 
 void gl33_sync_uniforms(ShaderProgram *prog) {
-	ht_foreach(&prog->uniforms, gl33_sync_uniform, NULL);
+	gl33_sync_samplers(prog);
+
+	Uniform *next;
+
+	for(Uniform *uniform = prog->dirty_uniforms; uniform; uniform = next) {
+		next = uniform->dirty_next;
+		uniform->dirty_next = NULL;
+		uniform->dirty = false;
+		gl33_commit_uniform(uniform);
+	}
+
+	prog->dirty_uniforms = NULL;
 }
 
 void gl33_uniform(Uniform *uniform, uint offset, uint count, const void *data) {
@@ -296,7 +337,10 @@ void gl33_uniform(Uniform *uniform, uint offset, uint count, const void *data) {
 			}
 		}
 
-		memcpy(uniform->textures + offset, textures, sizeof(Texture*) * count);
+		if(memcmp(uniform->textures + offset, textures, sizeof(Texture*) * count)) {
+			memcpy(uniform->textures + offset, textures, sizeof(Texture*) * count);
+			uniform->prog->samplers_dirty = true;
+		}
 	} else {
 		gl33_update_uniform(uniform, offset, count, data);
 	}
@@ -403,6 +447,7 @@ static bool cache_uniforms(ShaderProgram *prog) {
 
 		if(UNIFORM_TYPE_IS_SAMPLER(uni.type)) {
 			list_push(&sampler_uniforms, new_uni);
+			*dynarray_append(&prog->samplers) = new_uni;
 
 			if(glext.issues.avoid_sampler_uniform_updates) {
 				// Bind each sampler to a different texturing unit.
@@ -473,6 +518,7 @@ void gl33_unref_texture_from_samplers(Texture *tex) {
 		for(Texture **slot = u->textures; slot < u->textures + u->array_size; ++slot) {
 			if(*slot == tex) {
 				*slot = NULL;
+				u->prog->samplers_dirty = true;
 			}
 		}
 	}
@@ -513,39 +559,63 @@ void gl33_shader_program_destroy(ShaderProgram *prog) {
 	glDeleteProgram(prog->gl_handle);
 	ht_foreach(&prog->uniforms, free_uniform, NULL);
 	ht_destroy(&prog->uniforms);
+	dynarray_free_data(&prog->samplers);
 	free(prog);
 }
 
-ShaderProgram *gl33_shader_program_link(uint num_objects, ShaderObject *shobjs[num_objects]) {
-	ShaderProgram *prog = calloc(1, sizeof(*prog));
-
-	prog->gl_handle = glCreateProgram();
-	snprintf(prog->debug_label, sizeof(prog->debug_label), "Shader program #%i", prog->gl_handle);
-
+static bool link_program(GLuint gl_handle, uint num_objects, ShaderObject *shobjs[num_objects], bool retrievable) {
 	for(int i = 0; i < num_objects; ++i) {
 		ShaderObject *shobj = shobjs[i];
-		glAttachShader(prog->gl_handle, shobj->gl_handle);
+		glAttachShader(gl_handle, shobj->gl_handle);
 
 		for(int a = 0; a < shobj->num_attribs; ++a) {
 			GLSLAttribute *attr = shobj->attribs + a;
 			log_debug("Binding attribute %s to location %i", attr->name, attr->location);
-			glBindAttribLocation(prog->gl_handle, attr->location, attr->name);
+			glBindAttribLocation(gl_handle, attr->location, attr->name);
 		}
 	}
 
-	glLinkProgram(prog->gl_handle);
-	print_info_log(prog->gl_handle);
+	if(retrievable) {
+		gl33_program_cache_prepare_link(gl_handle);
+	}
+
+	glLinkProgram(gl_handle);
+	print_info_log(gl_handle);
 
 	GLint link_status;
-	glGetProgramiv(prog->gl_handle, GL_LINK_STATUS, &link_status);
+	glGetProgramiv(gl_handle, GL_LINK_STATUS, &link_status);
 
-	if(!link_status) {
-		log_error("Failed to link the shader program");
-		glDeleteProgram(prog->gl_handle);
-		free(prog);
-		return NULL;
+	return link_status;
+}
+
+ShaderProgram *gl33_shader_program_link(uint num_objects, ShaderObject *shobjs[num_objects]) {
+	ShaderProgram *prog = calloc(1, sizeof(*prog));
+	prog->samplers_dirty = true;
+
+	char cache_key[GL33_PROGRAM_CACHE_KEY_SIZE];
+	bool cacheable = gl33_program_cache_key(num_objects, shobjs, sizeof(cache_key), cache_key);
+
+	if(cacheable) {
+		prog->gl_handle = gl33_program_cache_load(cache_key);
+	}
+
+	if(!prog->gl_handle) {
+		prog->gl_handle = glCreateProgram();
+
+		if(!link_program(prog->gl_handle, num_objects, shobjs, cacheable)) {
+			log_error("Failed to link the shader program");
+			glDeleteProgram(prog->gl_handle);
+			free(prog);
+			return NULL;
+		}
+
+		if(cacheable) {
+			gl33_program_cache_store(cache_key, prog->gl_handle);
+		}
 	}
 
+	snprintf(prog->debug_label, sizeof(prog->debug_label), "Shader program #%i", prog->gl_handle);
+
 	if(!cache_uniforms(prog)) {
 		gl33_shader_program_destroy(prog);
 		return NULL;
@@ -13,6 +13,7 @@
 
 #include "util.h"
 #include "hashtable.h"
+#include "dynarray.h"
 #include "../api.h"
 #include "opengl.h"
 #include "resource/shader_program.h"
@@ -35,6 +36,14 @@ struct ShaderProgram {
 	GLuint gl_handle;
 	ht_str2ptr_t uniforms;
 	Uniform *magic_uniforms[NUM_MAGIC_UNIFORMS];
+
+	// uniforms with pending updates, linked through Uniform.dirty_next
+	Uniform *dirty_uniforms;
+
+	DYNAMIC_ARRAY(Uniform*) samplers;
+	uint32_t samplers_texunits_generation;
+	bool samplers_dirty;
+
 	char debug_label[R_DEBUG_LABEL_SIZE];
 };
 
@@ -52,6 +61,9 @@ struct Uniform {
 	// corresponding _SIZE uniform (for samplers; optional)
 	Uniform *size_uniform;
 
+	Uniform *dirty_next;
+	bool dirty;
+
 	struct {
 		// buffer size = elem_size * array_size
 		char *pending;
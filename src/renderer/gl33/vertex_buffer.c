@@ -45,3 +45,17 @@ void gl33_vertex_buffer_flush(VertexBuffer *vbuf) {
 SDL_RWops* gl33_vertex_buffer_get_stream(VertexBuffer *vbuf) {
 	return gl33_buffer_get_stream(&vbuf->cbuf);
 }
+
+void gl33_vertex_buffer_resize(VertexBuffer *vbuf, size_t capacity) {
+	size_t old_size = vbuf->cbuf.size;
+	gl33_buffer_resize(&vbuf->cbuf, capacity);
+	log_debug("Resized VBO %u from %zukb to %zukb", vbuf->cbuf.gl_handle, old_size / 1024, vbuf->cbuf.size / 1024);
+}
+
+void* gl33_vertex_buffer_map_write(VertexBuffer *vbuf, size_t *out_available) {
+	return gl33_buffer_map_write(&vbuf->cbuf, out_available);
+}
+
+void gl33_vertex_buffer_unmap_write(VertexBuffer *vbuf, size_t written) {
+	gl33_buffer_unmap_write(&vbuf->cbuf, written);
+}
@@ -23,6 +23,9 @@ void gl33_vertex_buffer_set_debug_label(VertexBuffer *vbuf, const char *label);
 void gl33_vertex_buffer_destroy(VertexBuffer *vbuf);
 void gl33_vertex_buffer_invalidate(VertexBuffer *vbuf);
 SDL_RWops* gl33_vertex_buffer_get_stream(VertexBuffer *vbuf);
+void gl33_vertex_buffer_resize(VertexBuffer *vbuf, size_t capacity);
+void* gl33_vertex_buffer_map_write(VertexBuffer *vbuf, size_t *out_available);
+void gl33_vertex_buffer_unmap_write(VertexBuffer *vbuf, size_t written);
 void gl33_vertex_buffer_flush(VertexBuffer *vbuf);
 
 #endif // IGUARD_renderer_gl33_vertex_buffer_h
@@ -427,6 +427,27 @@ static void glcommon_ext_float_blend(void) {
 	EXT_MISSING();
 }
 
+static void glcommon_ext_get_program_binary(void) {
+	EXT_FLAG(get_program_binary);
+
+#ifdef STATIC_GLES3
+	// Core in GLES 3.0, but WebGL 2 doesn't expose program binaries at all.
+	CHECK_CORE(!glext.version.is_webgl);
+	EXT_MISSING();
+#else
+	if(
+		HAVE_GL_FUNC(glGetProgramBinary) &&
+		HAVE_GL_FUNC(glProgramBinary) &&
+		HAVE_GL_FUNC(glProgramParameteri)
+	) {
+		CHECK_CORE(GL_ATLEAST(4, 1) || GLES_ATLEAST(3, 0));
+		CHECK_EXT(GL_ARB_get_program_binary);
+	}
+
+	EXT_MISSING();
+#endif
+}
+
 static void glcommon_ext_vertex_array_object(void) {
 	EXT_FLAG(vertex_array_object);
 
@@ -909,6 +930,7 @@ void glcommon_check_capabilities(void) {
 	glcommon_ext_depth_texture();
 	glcommon_ext_draw_buffers();
 	glcommon_ext_float_blend();
+	glcommon_ext_get_program_binary();
 	glcommon_ext_instanced_arrays();
 	glcommon_ext_internalformat_query2();
 	glcommon_ext_pixel_buffer_object();
@@ -156,6 +156,14 @@ static void null_vertex_buffer_set_debug_label(VertexBuffer *vbuf, const char *l
 static const char* null_vertex_buffer_get_debug_label(VertexBuffer *vbuf) { return "null vertex buffer"; }
 static void null_vertex_buffer_destroy(VertexBuffer *vbuf) { }
 static void null_vertex_buffer_invalidate(VertexBuffer *vbuf) { }
+static void null_vertex_buffer_resize(VertexBuffer *vbuf, size_t capacity) { }
+static void null_vertex_buffer_unmap_write(VertexBuffer *vbuf, size_t written) { }
+
+static void* null_vertex_buffer_map_write(VertexBuffer *vbuf, size_t *out_available) {
+	static char scratch[1 << 16];
+	*out_available = sizeof(scratch);
+	return scratch;
+}
 
 static IndexBuffer* null_index_buffer_create(size_t max_elements) { return (void*)&placeholder; }
 static size_t null_index_buffer_get_capacity(IndexBuffer *ibuf) { return UINT32_MAX; }
@@ -250,6 +258,9 @@ RendererBackend _r_backend_null = {
 		.vertex_buffer_destroy = null_vertex_buffer_destroy,
 		.vertex_buffer_invalidate = null_vertex_buffer_invalidate,
 		.vertex_buffer_get_stream = null_vertex_buffer_get_stream,
+		.vertex_buffer_resize = null_vertex_buffer_resize,
+		.vertex_buffer_map_write = null_vertex_buffer_map_write,
+		.vertex_buffer_unmap_write = null_vertex_buffer_unmap_write,
 		.index_buffer_create = null_index_buffer_create,
 		.index_buffer_get_capacity = null_index_buffer_get_capacity,
 		.index_buffer_get_debug_label = null_index_buffer_get_debug_label,
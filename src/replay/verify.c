@@ -0,0 +1,287 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#include "taisei.h"
+
+#include "verify.h"
+#include "replay.h"
+#include "struct.h"
+#include "state.h"
+
+#include "global.h"
+#include "hirestime.h"
+#include "taskmanager.h"
+#include "util.h"
+#include "vfs/public.h"
+
+#define VERIFY_MOUNTPOINT "/verify-replays"
+
+enum {
+	// How many replays may be loaded ahead of the one being played back.
+	VERIFY_MAX_PRELOADED = 2,
+};
+
+typedef enum ReplayVerifyStatus {
+	VERIFY_PENDING,
+	VERIFY_OK,
+	VERIFY_DESYNC,
+	VERIFY_LOAD_FAILED,
+} ReplayVerifyStatus;
+
+typedef struct ReplayVerifyEntry {
+	char *path;
+	Task *load_task;
+	Replay *replay;
+	ReplayVerifyStatus status;
+	uint16_t desync_stage;
+	int desync_frame;
+} ReplayVerifyEntry;
+
+typedef struct ReplayVerifyBatch {
+	DYNAMIC_ARRAY(ReplayVerifyEntry) entries;
+	dynarray_size_t current;
+	dynarray_size_t next_load;
+	CallChain next;
+	hrtime_t start_time;
+} ReplayVerifyBatch;
+
+static ReplayVerifyBatch *batch;
+
+static void replay_verify_batch_start_next(void);
+
+static void add_entry(ReplayVerifyBatch *b, char *path) {
+	*dynarray_append(&b->entries) = (ReplayVerifyEntry) {
+		.path = path,
+		.desync_frame = -1,
+	};
+}
+
+static bool filter_replay_files(const char *name) {
+	return strendswith(name, "." REPLAY_EXTENSION);
+}
+
+static bool collect_from_dir(ReplayVerifyBatch *b, const char *path) {
+	if(!vfs_mount_syspath(VERIFY_MOUNTPOINT, path, VFS_SYSPATH_MOUNT_READONLY)) {
+		return false;
+	}
+
+	bool is_dir = vfs_query(VERIFY_MOUNTPOINT).is_dir;
+
+	if(is_dir) {
+		size_t num_files = 0;
+		char **files = vfs_dir_list_sorted(
+			VERIFY_MOUNTPOINT, &num_files, vfs_dir_list_order_ascending, filter_replay_files
+		);
+
+		if(files) {
+			for(size_t i = 0; i < num_files; ++i) {
+				add_entry(b, vfs_syspath_join_alloc(path, files[i]));
+			}
+
+			vfs_dir_list_free(files, num_files);
+		}
+	}
+
+	vfs_unmount(VERIFY_MOUNTPOINT);
+	return is_dir;
+}
+
+static bool collect_from_list(ReplayVerifyBatch *b, const char *path) {
+	SDL_RWops *rw = SDL_RWFromFile(path, "r");
+
+	if(!rw) {
+		log_sdl_error(LOG_ERROR, "SDL_RWFromFile");
+		return false;
+	}
+
+	char buf[4096];
+
+	while(SDL_RWgets(rw, buf, sizeof(buf))) {
+		char *line = buf;
+		char *end = line + strlen(line);
+
+		while(*line && isspace((unsigned char)*line)) {
+			++line;
+		}
+
+		while(end > line && isspace((unsigned char)end[-1])) {
+			*--end = 0;
+		}
+
+		if(*line && *line != '#') {
+			add_entry(b, strdup(line));
+		}
+	}
+
+	SDL_RWclose(rw);
+	return true;
+}
+
+static void *replay_verify_load_task(void *arg) {
+	const char *path = arg;
+	Replay *rpy = calloc(1, sizeof(*rpy));
+
+	if(!replay_load_syspath(rpy, path, REPLAY_READ_ALL)) {
+		replay_reset(rpy);
+		free(rpy);
+		return NULL;
+	}
+
+	return rpy;
+}
+
+static void replay_verify_batch_finish(void) {
+	int num_total = batch->entries.num_elements;
+	int num_failed = 0;
+
+	dynarray_foreach_elem(&batch->entries, ReplayVerifyEntry *e, {
+		if(e->status != VERIFY_OK) {
+			++num_failed;
+		}
+
+		free(e->path);
+	});
+
+	double seconds = (time_get() - batch->start_time) / (double)HRTIME_RESOLUTION;
+	tsfprintf(stdout, "%i of %i replays passed verification in %.2f seconds\n", num_total - num_failed, num_total, seconds);
+
+	CallChain next = batch->next;
+	dynarray_free_data(&batch->entries);
+	free(batch);
+	batch = NULL;
+
+	run_call_chain(&next, (void*)(intptr_t)num_failed);
+}
+
+static void replay_verify_batch_post_play(CallChainResult ccr) {
+	ReplayVerifyEntry *e = ccr.ctx;
+
+	if(e->status == VERIFY_PENDING) {
+		e->status = VERIFY_OK;
+		tsfprintf(stdout, "%s: OK\n", e->path);
+	} else {
+		assert(e->status == VERIFY_DESYNC);
+		tsfprintf(stdout, "%s: DESYNC in stage %X at frame %i\n", e->path, e->desync_stage, e->desync_frame);
+	}
+
+	replay_reset(e->replay);
+	free(e->replay);
+	e->replay = NULL;
+
+	++batch->current;
+	replay_verify_batch_start_next();
+}
+
+static void replay_verify_batch_preload(void) {
+	dynarray_size_t end = imin(batch->current + 1 + VERIFY_MAX_PRELOADED, batch->entries.num_elements);
+
+	// Anything up to the current entry has already been loaded synchronously, if it wasn't preloaded.
+	batch->next_load = imax(batch->next_load, batch->current + 1);
+
+	if(batch->next_load >= end) {
+		return;
+	}
+
+	uint num_tasks = end - batch->next_load;
+	TaskParams params[VERIFY_MAX_PRELOADED];
+	Task *tasks[VERIFY_MAX_PRELOADED];
+	assert(num_tasks <= ARRAY_SIZE(params));
+
+	for(uint i = 0; i < num_tasks; ++i) {
+		params[i] = (TaskParams) {
+			.callback = replay_verify_load_task,
+			.userdata = dynarray_get(&batch->entries, batch->next_load + i).path,
+		};
+	}
+
+	uint num_submitted = taskmgr_global_submit_batch(num_tasks, params, tasks);
+
+	// Entries that didn't get a task are loaded synchronously when their turn comes.
+	for(uint i = 0; i < num_submitted; ++i) {
+		dynarray_get_ptr(&batch->entries, batch->next_load + i)->load_task = tasks[i];
+	}
+
+	batch->next_load = end;
+}
+
+static void replay_verify_batch_start_next(void) {
+	while(batch->current < batch->entries.num_elements) {
+		ReplayVerifyEntry *e = dynarray_get_ptr(&batch->entries, batch->current);
+		void *result = NULL;
+
+		if(e->load_task) {
+			task_finish(e->load_task, &result);
+			e->load_task = NULL;
+		} else {
+			result = replay_verify_load_task(e->path);
+		}
+
+		if(result == NULL) {
+			e->status = VERIFY_LOAD_FAILED;
+			tsfprintf(stdout, "%s: FAILED TO LOAD\n", e->path);
+			++batch->current;
+			continue;
+		}
+
+		e->replay = result;
+		replay_verify_batch_preload();
+		log_info("Verifying %s (%i/%i)", e->path, batch->current + 1, batch->entries.num_elements);
+
+		// Nothing may leak from the previous replay; stage_enter reseeds the game RNG from the replay itself.
+		global.gameover = GAMEOVER_NONE;
+		replay_state_deinit(&global.replay.input);
+		replay_state_deinit(&global.replay.output);
+
+		replay_play(e->replay, 0, CALLCHAIN(replay_verify_batch_post_play, e));
+		return;
+	}
+
+	replay_verify_batch_finish();
+}
+
+void replay_verify_batch(const char *path, CallChain next) {
+	assert(batch == NULL);
+
+	batch = calloc(1, sizeof(*batch));
+	batch->next = next;
+	batch->start_time = time_get();
+
+	if(!collect_from_dir(batch, path) && !collect_from_list(batch, path)) {
+		log_error("Can't read replays from %s", path);
+	} else if(batch->entries.num_elements == 0) {
+		log_error("No replays found in %s", path);
+	}
+
+	if(batch->entries.num_elements == 0) {
+		dynarray_free_data(&batch->entries);
+		free(batch);
+		batch = NULL;
+		run_call_chain(&next, (void*)(intptr_t)1);
+		return;
+	}
+
+	// The entries array must not be resized past this point; the load tasks reference the paths
+	// and the playback callbacks reference the entries themselves.
+	replay_verify_batch_start_next();
+}
+
+bool replay_verify_batch_is_active(void) {
+	return batch != NULL;
+}
+
+void replay_verify_batch_report_desync(uint16_t stage_id, int frame) {
+	assert(batch != NULL);
+
+	ReplayVerifyEntry *e = dynarray_get_ptr(&batch->entries, batch->current);
+
+	if(e->status == VERIFY_PENDING) {
+		e->status = VERIFY_DESYNC;
+		e->desync_stage = stage_id;
+		e->desync_frame = frame;
+	}
+}
@@ -0,0 +1,32 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#ifndef IGUARD_replay_verify_h
+#define IGUARD_replay_verify_h
+
+#include "taisei.h"
+
+#include "eventloop/eventloop.h"
+
+/*
+ * Batch replay verification (--verify-replays).
+ *
+ * [path] is either a directory, in which case every .tsr file in it is verified, or a text file
+ * listing one replay path per line. The replays are played back one after another in this
+ * process, so that the startup cost is only paid once; the next few are loaded ahead of time on
+ * the global task manager. A desync aborts the offending replay and moves on to the next one.
+ *
+ * [next] is called with the number of replays that failed to load or desynced, cast to a pointer.
+ */
+void replay_verify_batch(const char *path, CallChain next) attr_nonnull(1);
+bool replay_verify_batch_is_active(void);
+
+// Called by the stage loop on the first failed desync check of the current replay.
+void replay_verify_batch_report_desync(uint16_t stage_id, int frame);
+
+#endif // IGUARD_replay_verify_h
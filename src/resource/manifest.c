@@ -0,0 +1,189 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "manifest.h"
+#include "util.h"
+#include "util/io.h"
+
+// NOTE: These must match the type names in scripts/taiseilib/resmanifest.py
+static const char *const manifest_type_names[RES_NUMTYPES] = {
+	[RES_TEXTURE]        = "texture",
+	[RES_ANIM]           = "animation",
+	[RES_SFX]            = "sfx",
+	[RES_BGM]            = "bgm",
+	[RES_SHADER_OBJECT]  = "shader_object",
+	[RES_SHADER_PROGRAM] = "shader_program",
+	[RES_MODEL]          = "model",
+	[RES_POSTPROCESS]    = "postprocess",
+	[RES_SPRITE]         = "sprite",
+	[RES_FONT]           = "font",
+};
+
+typedef DYNAMIC_ARRAY(char*) ManifestTokens;
+
+static struct {
+	ht_str2ptr_t entries[RES_NUMTYPES];
+	bool loaded;
+} manifest;
+
+static bool parse_type(const char *str, size_t len, ResourceType *out_type) {
+	for(ResourceType t = 0; t < RES_NUMTYPES; ++t) {
+		const char *tname = manifest_type_names[t];
+
+		if(strlen(tname) == len && !memcmp(tname, str, len)) {
+			*out_type = t;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool parse_line(char *line, const char *path, int lineno, ManifestTokens *tokens) {
+	char *tok, *saveptr = NULL;
+	tokens->num_elements = 0;
+
+	for(tok = strtok_r(line, " \t\r\n", &saveptr); tok; tok = strtok_r(NULL, " \t\r\n", &saveptr)) {
+		*dynarray_append(tokens) = tok;
+	}
+
+	if(tokens->num_elements == 0 || *dynarray_get(tokens, 0) == '#') {
+		return true;
+	}
+
+	if(tokens->num_elements < 3) {
+		log_error("%s:%i: Malformed entry", path, lineno);
+		return false;
+	}
+
+	ResourceType type;
+	const char *typename = dynarray_get(tokens, 0);
+	const char *name = dynarray_get(tokens, 1);
+	char *endptr;
+	uint64_t size = strtoull(dynarray_get(tokens, 2), &endptr, 10);
+
+	if(!parse_type(typename, strlen(typename), &type)) {
+		log_error("%s:%i: Unknown resource type '%s'", path, lineno, typename);
+		return false;
+	}
+
+	if(*endptr) {
+		log_error("%s:%i: Malformed size", path, lineno);
+		return false;
+	}
+
+	uint num_deps = tokens->num_elements - 3;
+	size_t alloc_size = sizeof(ResourceManifestEntry) + num_deps * sizeof(ResourceManifestDep);
+
+	for(uint i = 0; i < num_deps; ++i) {
+		alloc_size += strlen(dynarray_get(tokens, i + 3)) + 1;
+	}
+
+	ResourceManifestEntry *e = calloc(1, alloc_size);
+	e->size = size;
+	e->num_deps = num_deps;
+	char *strbuf = (char*)(e->deps + num_deps);
+
+	for(uint i = 0; i < num_deps; ++i) {
+		const char *dep = dynarray_get(tokens, i + 3);
+		const char *sep = strchr(dep, ':');
+
+		if(!sep || !parse_type(dep, sep - dep, &e->deps[i].type)) {
+			log_error("%s:%i: Malformed dependency '%s'", path, lineno, dep);
+			free(e);
+			return false;
+		}
+
+		size_t len = strlen(sep + 1) + 1;
+		memcpy(strbuf, sep + 1, len);
+		e->deps[i].name = strbuf;
+		strbuf += len;
+	}
+
+	free(ht_get(manifest.entries + type, name, NULL));
+	ht_set(manifest.entries + type, name, e);
+	return true;
+}
+
+bool res_manifest_load(const char *path) {
+	res_manifest_unload();
+
+	SDL_RWops *rw = vfs_open(path, VFS_MODE_READ);
+
+	if(!rw) {
+		log_debug("VFS error: %s", vfs_get_error());
+		return false;
+	}
+
+	for(ResourceType t = 0; t < RES_NUMTYPES; ++t) {
+		ht_create(manifest.entries + t);
+	}
+
+	manifest.loaded = true;
+
+	size_t bufsize = 256;
+	char *buf = calloc(1, bufsize);
+	ManifestTokens tokens = { 0 };
+	int lineno = 0;
+	bool ok = true;
+
+	while(SDL_RWgets_realloc(rw, &buf, &bufsize)) {
+		if(!parse_line(buf, path, ++lineno, &tokens)) {
+			ok = false;
+			break;
+		}
+	}
+
+	dynarray_free_data(&tokens);
+	free(buf);
+	SDL_RWclose(rw);
+
+	if(!ok) {
+		res_manifest_unload();
+		return false;
+	}
+
+	uint num_entries = 0;
+
+	for(ResourceType t = 0; t < RES_NUMTYPES; ++t) {
+		num_entries += manifest.entries[t].num_elements_occupied;
+	}
+
+	log_info("Loaded %u entries from resource manifest '%s'", num_entries, path);
+	return true;
+}
+
+void res_manifest_unload(void) {
+	if(!manifest.loaded) {
+		return;
+	}
+
+	for(ResourceType t = 0; t < RES_NUMTYPES; ++t) {
+		ht_str2ptr_iter_t iter;
+		ht_iter_begin(manifest.entries + t, &iter);
+
+		for(; iter.has_data; ht_iter_next(&iter)) {
+			free(iter.value);
+		}
+
+		ht_iter_end(&iter);
+		ht_destroy(manifest.entries + t);
+	}
+
+	manifest.loaded = false;
+}
+
+const ResourceManifestEntry *res_manifest_lookup(ResourceType type, const char *name) {
+	if(!manifest.loaded) {
+		return NULL;
+	}
+
+	return ht_get(manifest.entries + type, name, NULL);
+}
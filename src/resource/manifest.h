@@ -0,0 +1,45 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#ifndef IGUARD_resource_manifest_h
+#define IGUARD_resource_manifest_h
+
+#include "taisei.h"
+
+#include "resource.h"
+
+/*
+ * The resource manifest is generated at build time (see scripts/taiseilib/resmanifest.py) and
+ * records the size and the direct dependencies of every resource in the package. It lets the
+ * loader schedule a resource's whole dependency graph at once, instead of discovering it one
+ * level at a time as the load procs call res_load_dependency().
+ *
+ * The manifest is only a hint. Resources that aren't listed in it (e.g. user-provided ones) are
+ * loaded as usual, and the load procs still register their dependencies themselves.
+ */
+
+#define RES_MANIFEST_PATH "res/manifest.txt"
+
+typedef struct ResourceManifestDep {
+	const char *name;
+	ResourceType type;
+} ResourceManifestDep;
+
+typedef struct ResourceManifestEntry {
+	uint64_t size;
+	uint num_deps;
+	ResourceManifestDep deps[];
+} ResourceManifestEntry;
+
+bool res_manifest_load(const char *path) attr_nonnull_all;
+void res_manifest_unload(void);
+
+// Must not be called concurrently with res_manifest_load/res_manifest_unload.
+const ResourceManifestEntry *res_manifest_lookup(ResourceType type, const char *name) attr_nonnull_all;
+
+#endif // IGUARD_resource_manifest_h
@@ -14,6 +14,7 @@
 #include "menu/mainmenu.h"
 #include "events.h"
 #include "taskmanager.h"
+#include "manifest.h"
 
 #include "texture.h"
 #include "animation.h"
@@ -64,6 +65,9 @@ struct InternalResource {
 	SDL_cond *cond;
 	InternalResLoadState *load;
 	ResourceStatus status;
+
+	// Time spent in this resource's load procs plus the longest critical path among its dependencies
+	hrtime_t critical_path_time;
 };
 
 struct InternalResLoadState {
@@ -74,12 +78,32 @@ struct InternalResLoadState {
 	char *allocated_path;
 	ResourceLoadProc continuation;
 	DYNAMIC_ARRAY(InternalResource*) dependencies;
+	hrtime_t proc_time;
+	int task_prio;
 	LoadStatus status;
 	bool ready_to_finalize;
 };
 
+#define RES_CACHE_SIZE 512
+#define RES_CACHE_MAX_NAME 48
+
+typedef struct ResourceCacheEntry {
+	const char *name_ptr;
+	const char *prefix;
+	void *data;
+	ResourceType type;
+	char name[RES_CACHE_MAX_NAME];
+} ResourceCacheEntry;
+
 static struct {
 	hrtime_t frame_threshold;
+	uint32_t generation;
+
+	struct {
+		ResourceCacheEntry entries[RES_CACHE_SIZE];
+		uint32_t generation;
+	} cache;
+
 	uchar loaded_this_frame : 1;
 	struct {
 		uchar no_async_load : 1;
@@ -170,6 +194,17 @@ static bool try_begin_load_resource(ResourceType type, const char *name, hash_t
 
 static void load_resource_finish(InternalResLoadState *st);
 
+static void run_load_proc(InternalResLoadState *st, ResourceLoadProc proc) {
+	hrtime_t begin = time_get();
+	st->status = LOAD_NONE;
+	proc(&st->st);
+	st->proc_time += time_get() - begin;
+}
+
+static double hrtime_to_ms(hrtime_t t) {
+	return t / (double)(HRTIME_RESOLUTION / HRTIME_C(1000));
+}
+
 static ResourceStatus pump_or_wait_for_dependencies(InternalResLoadState *st, bool pump_only);
 
 static ResourceStatus pump_dependencies(InternalResLoadState *st) {
@@ -288,10 +323,7 @@ static void *load_resource_async_task(void *vdata) {
 	assume(st == ires->load);
 
 	SDL_LockMutex(ires->mutex);
-	ResourceHandler *h = get_ires_handler(ires);
-
-	st->status = LOAD_NONE;
-	h->procs.load(&st->st);
+	run_load_proc(st, get_ires_handler(ires)->procs.load);
 
 retry:
 	switch(st->status) {
@@ -305,8 +337,7 @@ static void *load_resource_async_task(void *vdata) {
 					dep_status = wait_for_dependencies(st);
 				}
 
-				st->status = LOAD_NONE;
-				st->continuation(&st->st);
+				run_load_proc(st, st->continuation);
 				goto retry;
 			} else {
 				dep_status = pump_dependencies(st);
@@ -317,8 +348,7 @@ static void *load_resource_async_task(void *vdata) {
 					events_emit(TE_RESOURCE_ASYNC_LOADED, 0, ires, NULL);
 					break;
 				} else {
-					st->status = LOAD_NONE;
-					st->continuation(&st->st);
+					run_load_proc(st, st->continuation);
 					goto retry;
 				}
 			}
@@ -355,6 +385,7 @@ static SDLCALL int filter_asyncload_event(void *vires, SDL_Event *event) {
 
 static void unload_resource(InternalResource *ires) {
 	assert(is_main_thread());
+	++res_gstate.generation;
 
 	if(wait_for_resource_load(ires, 0) == RES_STATUS_LOADED) {
 		get_handler(ires->res.type)->procs.unload(ires->res.data);
@@ -474,7 +505,30 @@ static InternalResLoadState *make_persistent_loadstate(InternalResLoadState *st_
 
 static void load_resource_async(InternalResLoadState *st_transient) {
 	InternalResLoadState *st = make_persistent_loadstate(st_transient);
-	st->async_task = taskmgr_global_submit((TaskParams) { load_resource_async_task, st });
+	st->async_task = taskmgr_global_submit((TaskParams) {
+		.callback = load_resource_async_task,
+		.userdata = st,
+		.prio = st->task_prio,
+	});
+}
+
+static int get_load_task_prio(ResourceType type, const char *name) {
+	const ResourceManifestEntry *e = res_manifest_lookup(type, name);
+
+	if(!e) {
+		return 0;
+	}
+
+	// Start with the biggest files, so that they don't end up stuck behind a long queue of small
+	// ones and extend the critical path. Sizes are bucketed by powers of two to preserve the
+	// submission order (and thus dependencies before dependents) among similar resources.
+	int prio = 0;
+
+	for(uint64_t size = e->size; size > 1; size >>= 1) {
+		--prio;
+	}
+
+	return prio;
 }
 
 attr_nonnull_all
@@ -507,6 +561,7 @@ static void load_resource(InternalResource *ires, const char *name, ResourceFlag
 	InternalResLoadState st = {
 		.ires = ires,
 		.allocated_path = path,
+		.task_prio = async ? get_load_task_prio(handler->type, name) : 0,
 		.st = {
 			.name = name,
 			.path = path,
@@ -520,8 +575,7 @@ static void load_resource(InternalResource *ires, const char *name, ResourceFlag
 	} else if(async) {
 		load_resource_async(&st);
 	} else {
-		st.status = LOAD_NONE;
-		handler->procs.load(&st.st);
+		run_load_proc(&st, handler->procs.load);
 
 		retry: switch(st.status) {
 			case LOAD_OK:
@@ -532,8 +586,7 @@ static void load_resource(InternalResource *ires, const char *name, ResourceFlag
 			case LOAD_CONT:
 			case LOAD_CONT_ON_MAIN:
 				wait_for_dependencies(&st);
-				st.status = LOAD_NONE;
-				st.continuation(&st.st);
+				run_load_proc(&st, st.continuation);
 				goto retry;
 			default: UNREACHABLE;
 		}
@@ -551,8 +604,7 @@ static void load_resource_finish(InternalResLoadState *st) {
 		retry: switch(st->status) {
 			case LOAD_CONT:
 			case LOAD_CONT_ON_MAIN:
-				st->status = LOAD_NONE;
-				st->continuation(&st->st);
+				run_load_proc(st, st->continuation);
 				goto retry;
 
 			case LOAD_OK:
@@ -567,6 +619,18 @@ static void load_resource_finish(InternalResLoadState *st) {
 		}
 	}
 
+	if(raw) {
+		hrtime_t deps_critical_path_time = 0;
+
+		dynarray_foreach_elem(&st->dependencies, InternalResource **dep, {
+			if((*dep)->critical_path_time > deps_critical_path_time) {
+				deps_critical_path_time = (*dep)->critical_path_time;
+			}
+		});
+
+		ires->critical_path_time = st->proc_time + deps_critical_path_time;
+	}
+
 	dynarray_free_data(&st->dependencies);
 
 	const char *name = NOT_NULL(st->st.name);
@@ -585,7 +649,15 @@ static void load_resource_finish(InternalResLoadState *st) {
 
 	if(raw) {
 		ires->status = RES_STATUS_LOADED;
-		log_info("Loaded %s '%s' from '%s' (%s)", typename, name, source, (ires->res.flags & RESF_PERMANENT) ? "permanent" : "transient");
+		log_info(
+			"Loaded %s '%s' from '%s' (%s; %.2f ms, %.2f ms critical path)",
+			typename,
+			name,
+			source,
+			(ires->res.flags & RESF_PERMANENT) ? "permanent" : "transient",
+			hrtime_to_ms(st->proc_time),
+			hrtime_to_ms(ires->critical_path_time)
+		);
 	} else {
 		ires->status = RES_STATUS_FAILED;
 
@@ -668,10 +740,80 @@ void *_get_resource_data(ResourceType type, const char *name, hash_t hash, Resou
 	return NULL;
 }
 
+uint32_t res_generation(void) {
+	return res_gstate.generation;
+}
+
+void *_res_ref_resolve(ResourceRef *ref, ResourceType type, const char *name, ResourceFlags flags) {
+	assert(is_main_thread());
+	ref->data = get_resource_data(type, name, flags);
+	ref->generation = res_gstate.generation;
+	return ref->data;
+}
+
+void *res_cache_lookup(ResourceType type, const char *prefix, const char *name, ResourceFlags flags) {
+	assert(is_main_thread());
+
+	if(res_gstate.cache.generation != res_gstate.generation) {
+		memset(res_gstate.cache.entries, 0, sizeof(res_gstate.cache.entries));
+		res_gstate.cache.generation = res_gstate.generation;
+	}
+
+	uintptr_t key = (uintptr_t)name ^ ((uintptr_t)prefix >> 3) ^ type;
+	key ^= key >> 9;
+	key ^= key >> 17;
+
+	ResourceCacheEntry *e = res_gstate.cache.entries + ((key >> 3) & (RES_CACHE_SIZE - 1));
+
+	if(e->name_ptr == name && e->prefix == prefix && e->type == type && !strcmp(e->name, name)) {
+		return e->data;
+	}
+
+	void *data;
+	size_t name_len = strlen(name);
+
+	if(prefix) {
+		size_t prefix_len = strlen(prefix);
+		char buf[prefix_len + name_len + 1];
+		memcpy(buf, prefix, prefix_len);
+		memcpy(buf + prefix_len, name, name_len + 1);
+		data = get_resource_data(type, buf, flags);
+	} else {
+		data = get_resource_data(type, name, flags);
+	}
+
+	if(data && name_len < sizeof(e->name)) {
+		e->name_ptr = name;
+		e->prefix = prefix;
+		e->type = type;
+		e->data = data;
+		memcpy(e->name, name, name_len + 1);
+	}
+
+	return data;
+}
+
+static void preload_manifest_dependencies(ResourceType type, const char *name, ResourceFlags flags) {
+	const ResourceManifestEntry *e = res_manifest_lookup(type, name);
+
+	if(e) {
+		for(uint i = 0; i < e->num_deps; ++i) {
+			preload_resource_internal(e->deps[i].type, e->deps[i].name, flags);
+		}
+	}
+}
+
 static InternalResource *preload_resource_internal(ResourceType type, const char *name, ResourceFlags flags) {
 	InternalResource *ires;
 
 	if(try_begin_load_resource(type, name, ht_str2ptr_hash(name), &ires)) {
+		if(!res_gstate.env.no_async_load) {
+			// Submit the whole dependency graph now, instead of waiting for the load procs to
+			// discover it one level at a time. The procs will still register the dependencies
+			// themselves, which is a no-op for those that are already loading.
+			preload_manifest_dependencies(type, name, flags);
+		}
+
 		SDL_LockMutex(ires->mutex);
 		load_resource(ires, name, flags, !res_gstate.env.no_async_load);
 		SDL_UnlockMutex(ires->mutex);
@@ -712,6 +854,10 @@ void init_resources(void) {
 		}
 	}
 
+	if(env_get("TAISEI_RES_MANIFEST", true)) {
+		res_manifest_load(RES_MANIFEST_PATH);
+	}
+
 	if(!res_gstate.env.no_async_load) {
 		EventHandler h = {
 			.proc = resource_asyncload_handler,
@@ -821,6 +967,32 @@ void load_resources(void) {
 	}
 }
 
+void res_wait_for_pending_loads(void) {
+	DYNAMIC_ARRAY(InternalResource*) pending = { 0 };
+	ht_str2ptr_ts_iter_t iter;
+
+	// Don't wait while iterating: loads in progress may need to add their dependencies to the map.
+	// Those don't need to be collected here, as a resource is only done after its dependencies are.
+
+	for(ResourceType type = 0; type < RES_NUMTYPES; ++type) {
+		ResourceHandler *handler = get_handler(type);
+
+		ht_iter_begin(&handler->private.mapping, &iter);
+
+		for(; iter.has_data; ht_iter_next(&iter)) {
+			*dynarray_append(&pending) = iter.value;
+		}
+
+		ht_iter_end(&iter);
+	}
+
+	dynarray_foreach_elem(&pending, InternalResource **pires, {
+		wait_for_resource_load(*pires, 0);
+	});
+
+	dynarray_free_data(&pending);
+}
+
 void free_resources(bool all) {
 	ht_str2ptr_ts_iter_t iter;
 
@@ -895,6 +1067,8 @@ void free_resources(bool all) {
 		return;
 	}
 
+	res_manifest_unload();
+
 	if(!res_gstate.env.no_async_load) {
 		events_unregister_handler(resource_asyncload_handler);
 	}
@@ -130,8 +130,38 @@ INLINE void *get_resource_data(ResourceType type, const char *name, ResourceFlag
 	return _get_resource_data(type, name, ht_str2ptr_hash(name), flags);
 }
 
+// Incremented whenever a resource is unloaded.
+// Resource pointers remembered from an older generation may be dangling and must be looked up again.
+uint32_t res_generation(void);
+
+// A remembered resource lookup, e.g. in a static variable or a prototype. Main thread only.
+typedef struct ResourceRef {
+	void *data;
+	uint32_t generation;
+} ResourceRef;
+
+void *_res_ref_resolve(ResourceRef *ref, ResourceType type, const char *name, ResourceFlags flags) attr_nonnull_all;
+
+attr_nonnull_all
+INLINE void *res_ref_get(ResourceRef *ref, ResourceType type, const char *name, ResourceFlags flags) {
+	if(LIKELY(ref->data != NULL) && ref->generation == res_generation()) {
+		return ref->data;
+	}
+
+	return _res_ref_resolve(ref, type, name, flags);
+}
+
+// Like get_resource_data(), but goes through a small cache keyed by the address of [name] first.
+// This makes names that are string literals (.sprite = "...") nearly free to resolve, without
+// hashing or locking. The contents are compared as well, so reused name buffers are fine.
+// [prefix] is prepended to the name and may be NULL; it must have static storage. Main thread only.
+void *res_cache_lookup(ResourceType type, const char *prefix, const char *name, ResourceFlags flags) attr_nonnull(3);
+
 void preload_resource(ResourceType type, const char *name, ResourceFlags flags);
 void preload_resources(ResourceType type, ResourceFlags flags, const char *firstname, ...) attr_sentinel;
+// Blocks until every resource that has been requested so far has finished loading (or failed to).
+void res_wait_for_pending_loads(void);
+
 void *resource_for_each(ResourceType type, void *(*callback)(const char *name, Resource *res, void *arg), void *arg);
 
 void resource_util_strip_ext(char *path);
@@ -142,6 +172,14 @@ const char *resource_util_filename(const char *path);
 	attr_nonnull_all attr_returns_nonnull \
 	INLINE _type *_name(const char *resname) { \
 		return NOT_NULL(get_resource_data(_enum, resname, RESF_DEFAULT)); \
+	} \
+	attr_nonnull_all attr_returns_nonnull \
+	INLINE _type *_name##_ref(ResourceRef *ref, const char *resname) { \
+		return NOT_NULL(res_ref_get(ref, _enum, resname, RESF_DEFAULT)); \
+	} \
+	attr_nonnull_all attr_returns_nonnull \
+	INLINE _type *_name##_cached(const char *resname) { \
+		return NOT_NULL(res_cache_lookup(_enum, NULL, resname, RESF_DEFAULT)); \
 	}
 
 #define DEFINE_OPTIONAL_RESOURCE_GETTER(_type, _name, _enum) \
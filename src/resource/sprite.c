@@ -132,12 +132,7 @@ static void load_sprite_stage2(ResourceLoadState *st) {
 }
 
 Sprite *prefix_get_sprite(const char *name, const char *prefix) {
-	uint plen = strlen(prefix);
-	char buf[plen + strlen(name) + 1];
-	strcpy(buf, prefix);
-	strcpy(buf + plen, name);
-	Sprite *spr = res_sprite(buf);
-	return spr;
+	return NOT_NULL(res_cache_lookup(RES_SPRITE, prefix, name, RESF_DEFAULT));
 }
 
 static void begin_draw_sprite(float x, float y, float scale_x, float scale_y, Sprite *spr) {
@@ -161,7 +156,7 @@ static void draw_sprite_ex(float x, float y, float scale_x, float scale_y, Sprit
 }
 
 void draw_sprite(float x, float y, const char *name) {
-	draw_sprite_p(x, y, res_sprite(name));
+	draw_sprite_p(x, y, res_sprite_cached(name));
 }
 
 void draw_sprite_p(float x, float y, Sprite *spr) {
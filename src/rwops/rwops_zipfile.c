@@ -29,6 +29,14 @@ typedef struct ZipRWData {
 	zip_flags_t open_flags;
 } ZipRWData;
 
+// Reads uncompressed members straight from the memory-mapped archive
+typedef struct ZipMappedRWData {
+	VFSNode *node;
+	const uint8_t *data;
+	int64_t pos;
+	int64_t size;
+} ZipMappedRWData;
+
 #define ZTLS(pdata) vfs_zipfile_get_tls((pdata)->zipnode, true)
 
 static int ziprw_reopen(SDL_RWops *rw) {
@@ -164,7 +172,92 @@ static size_t ziprw_write(SDL_RWops *rw, const void *ptr, size_t size, size_t ma
 	return -1;
 }
 
+static int ziprw_mapped_close(SDL_RWops *rw) {
+	if(rw) {
+		ZipMappedRWData *rwdata = rw->hidden.unknown.data1;
+		vfs_decref(rwdata->node);
+		free(rwdata);
+		SDL_FreeRW(rw);
+	}
+
+	return 0;
+}
+
+static int64_t ziprw_mapped_seek(SDL_RWops *rw, int64_t offset, int whence) {
+	ZipMappedRWData *rwdata = rw->hidden.unknown.data1;
+	int64_t pos;
+
+	switch(whence) {
+		case RW_SEEK_SET: pos = offset; break;
+		case RW_SEEK_CUR: pos = rwdata->pos + offset; break;
+		case RW_SEEK_END: pos = rwdata->size + offset; break;
+		default: return SDL_SetError("Bad whence value %i", whence);
+	}
+
+	if(pos < 0 || pos > rwdata->size) {
+		return SDL_SetError("Seek offset out of range");
+	}
+
+	return rwdata->pos = pos;
+}
+
+static int64_t ziprw_mapped_size(SDL_RWops *rw) {
+	ZipMappedRWData *rwdata = rw->hidden.unknown.data1;
+	return rwdata->size;
+}
+
+static size_t ziprw_mapped_read(SDL_RWops *rw, void *ptr, size_t size, size_t maxnum) {
+	ZipMappedRWData *rwdata = rw->hidden.unknown.data1;
+
+	if(UNLIKELY(size == 0)) {
+		return 0;
+	}
+
+	size_t num = imin(maxnum, (rwdata->size - rwdata->pos) / size);
+	memcpy(ptr, rwdata->data + rwdata->pos, num * size);
+	rwdata->pos += num * size;
+
+	return num;
+}
+
+static SDL_RWops *ziprw_open_mapped(VFSNode *znode, const uint8_t *data, int64_t size) {
+	SDL_RWops *rw = SDL_AllocRW();
+
+	if(UNLIKELY(!rw)) {
+		return NULL;
+	}
+
+	memset(rw, 0, sizeof(SDL_RWops));
+
+	ZipMappedRWData *rwdata = calloc(1, sizeof(*rwdata));
+	rwdata->node = znode;
+	rwdata->data = data;
+	rwdata->size = size;
+
+	// NOTE: The zip file node owns the mapping, and our node keeps it alive.
+	vfs_incref(znode);
+
+	rw->hidden.unknown.data1 = rwdata;
+	rw->type = SDL_RWOPS_UNKNOWN;
+
+	rw->size = ziprw_mapped_size;
+	rw->close = ziprw_mapped_close;
+	rw->read = ziprw_mapped_read;
+	rw->write = ziprw_write;
+	rw->seek = ziprw_mapped_seek;
+
+	return rw;
+}
+
 SDL_RWops *SDL_RWFromZipFile(VFSNode *znode, VFSZipPathData *pdata) {
+	if(pdata->compression == ZIP_CM_STORE && pdata->size >= 0) {
+		const uint8_t *mapped = vfs_zipfile_get_mapped_data(pdata->zipnode, pdata->index, pdata->size);
+
+		if(mapped) {
+			return ziprw_open_mapped(znode, mapped, pdata->size);
+		}
+	}
+
 	SDL_RWops *rw = SDL_AllocRW();
 
 	if(UNLIKELY(!rw)) {
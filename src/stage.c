@@ -16,6 +16,7 @@
 #include "replay/state.h"
 #include "replay/stage.h"
 #include "replay/struct.h"
+#include "replay/verify.h"
 #include "config.h"
 #include "player.h"
 #include "menu/ingamemenu.h"
@@ -25,6 +26,8 @@
 #include "stagetext.h"
 #include "stagedraw.h"
 #include "stageobjects.h"
+#include "enemy_grid.h"
+#include "benchmark.h"
 #include "eventloop/eventloop.h"
 #include "common_tasks.h"
 #include "stageinfo.h"
@@ -120,6 +123,44 @@ INLINE void skipstate_shutdown(void) { }
 
 #endif
 
+static struct {
+	int target_frame;
+	int bgm_start_time;
+	double bgm_start_pos;
+} replay_seek;
+
+bool stage_is_replay_seeking(void) {
+	return replay_seek.target_frame > 0;
+}
+
+void stage_replay_seek(int frame) {
+	assert(global.replay.input.replay != NULL);
+
+	log_info("Seeking from frame %i to %i", global.frames, frame);
+
+	replay_seek.target_frame = frame;
+	replay_seek.bgm_start_time = global.frames;
+	replay_seek.bgm_start_pos = audio_bgm_tell();
+
+	if(frame <= global.frames) {
+		// There is no way to rewind the game state, so simulate the stage again from the start.
+		// This takes time proportional to the target frame, not to the seek distance.
+		global.gameover = GAMEOVER_RESTART;
+	}
+}
+
+static bool replay_seek_handle_bgm_change(SDL_Event *evt, void *a) {
+	replay_seek.bgm_start_time = global.frames;
+	replay_seek.bgm_start_pos = audio_bgm_tell();
+	return false;
+}
+
+static void replay_seek_finish(void) {
+	log_info("Reached frame %i", global.frames);
+	audio_bgm_seek_realtime(replay_seek.bgm_start_pos + (global.frames - replay_seek.bgm_start_time) / (double)FPS);
+	memset(&replay_seek, 0, sizeof(replay_seek));
+}
+
 static void stage_start(StageInfo *stage) {
 	global.timer = 0;
 	global.frames = 0;
@@ -223,7 +264,7 @@ static void stage_enter_ingame_menu(MenuData *m, BGM *bgm, CallChain next) {
 }
 
 void stage_pause(void) {
-	if(global.gameover == GAMEOVER_TRANSITIONING || stage_is_skip_mode()) {
+	if(global.gameover == GAMEOVER_TRANSITIONING || stage_is_skip_mode() || stage_is_replay_seeking()) {
 		return;
 	}
 
@@ -387,6 +428,7 @@ static void handle_replay_event(ReplayEvent *e, void *arg) {
 static void replay_input(void) {
 	events_poll((EventHandler[]){
 		{ .proc = stage_input_handler_replay },
+		{ .proc = replay_seek_handle_bgm_change, .event_type = MAKE_TAISEI_EVENT(TE_AUDIO_BGM_STARTED) },
 		{ NULL }
 	}, EFLAG_GAME);
 
@@ -436,12 +478,28 @@ static void stage_input(void) {
 }
 
 static void stage_logic(void) {
-	process_boss(&global.boss);
-	process_enemies(&global.enemies);
-	process_projectiles(&global.projs, true);
-	process_items();
-	process_lasers();
-	process_projectiles(&global.particles, false);
+	BENCH_SECTION(BENCH_SECTION_ENEMIES, {
+		process_boss(&global.boss);
+		process_enemies(&global.enemies);
+	});
+
+	BENCH_SECTION(BENCH_SECTION_PROJECTILES, {
+		enemy_grid_begin(&global.enemies);
+		process_projectiles(&global.projs, true);
+		enemy_grid_end();
+	});
+
+	BENCH_SECTION(BENCH_SECTION_ITEMS, {
+		process_items();
+	});
+
+	BENCH_SECTION(BENCH_SECTION_LASERS, {
+		process_lasers();
+	});
+
+	BENCH_SECTION(BENCH_SECTION_PARTICLES, {
+		process_projectiles(&global.particles, false);
+	});
 
 	if(global.dialog) {
 		dialog_update(global.dialog);
@@ -602,6 +660,7 @@ static void stage_free(void) {
 	projectiles_free();
 	lasers_free();
 	stagetext_free();
+	enemy_grid_shutdown();
 }
 
 static void stage_finalize(void *arg) {
@@ -733,7 +792,7 @@ INLINE bool stage_should_yield(void) {
 	return (global.boss && !boss_is_fleeing(global.boss)) || dialog_is_active(global.dialog);
 }
 
-static LogicFrameAction stage_logic_frame(void *arg) {
+static LogicFrameAction stage_logic_frame_internal(void *arg) {
 	StageFrameState *fstate = arg;
 	StageInfo *stage = fstate->stage;
 
@@ -755,7 +814,9 @@ static LogicFrameAction stage_logic_frame(void *arg) {
 	}
 
 	if(global.gameover != GAMEOVER_TRANSITIONING) {
-		cosched_run_tasks(&fstate->sched);
+		BENCH_SECTION(BENCH_SECTION_COROUTINES, {
+			cosched_run_tasks(&fstate->sched);
+		});
 
 		if(!stage_should_yield()) {
 			stage->procs->event();
@@ -790,7 +851,14 @@ static LogicFrameAction stage_logic_frame(void *arg) {
 		global.is_replay_verification &&
 		!global.replay.output.stage
 	) {
-		exit(1);
+		if(!replay_verify_batch_is_active()) {
+			exit(1);
+		}
+
+		// abandon this replay and let the batch verifier move on to the next one
+		replay_verify_batch_report_desync(global.stage->id, global.frames);
+		global.gameover = GAMEOVER_ABORT;
+		return LFRAME_STOP;
 	}
 
 	stage_logic();
@@ -811,6 +879,14 @@ static LogicFrameAction stage_logic_frame(void *arg) {
 		return LFRAME_STOP;
 	}
 
+	if(stage_is_replay_seeking()) {
+		if(global.frames < replay_seek.target_frame) {
+			return LFRAME_SKIP_ALWAYS;
+		}
+
+		replay_seek_finish();
+	}
+
 	LogicFrameAction skipmode = skipstate_handle_frame();
 	if(skipmode != LFRAME_WAIT) {
 		return skipmode;
@@ -823,11 +899,18 @@ static LogicFrameAction stage_logic_frame(void *arg) {
 	return LFRAME_WAIT;
 }
 
+static LogicFrameAction stage_logic_frame(void *arg) {
+	bench_frame_begin();
+	LogicFrameAction action = stage_logic_frame_internal(arg);
+	bench_frame_end();
+	return action;
+}
+
 static RenderFrameAction stage_render_frame(void *arg) {
 	StageFrameState *fstate = arg;
 	StageInfo *stage = fstate->stage;
 
-	if(stage_is_skip_mode()) {
+	if(stage_is_skip_mode() || stage_is_replay_seeking()) {
 		return RFRAME_DROP;
 	}
 
@@ -881,7 +964,11 @@ void stage_enter(StageInfo *stage, CallChain next) {
 	ent_init();
 	stage_objpools_alloc();
 	stage_draw_pre_init();
+
+	hrtime_t preload_begin_time = bench_section_begin();
 	stage_preload();
+	bench_stage_preloaded(preload_begin_time);
+
 	stage_draw_init();
 
 	rng_make_active(&global.rand_game);
@@ -977,12 +1064,17 @@ void stage_end_loop(void* ctx) {
 	free_all_refs();
 	ent_shutdown();
 	rng_make_active(&global.rand_visual);
+	bench_stage_end();
 	stage_objpools_free();
 	stop_all_sfx();
 
 	taisei_commit_persistent_data();
 	skipstate_shutdown();
 
+	if(global.gameover != GAMEOVER_RESTART) {
+		memset(&replay_seek, 0, sizeof(replay_seek));
+	}
+
 	if(taisei_quit_requested()) {
 		global.gameover = GAMEOVER_ABORT;
 	}
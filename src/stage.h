@@ -80,6 +80,10 @@ void stage_finish(int gameover);
 void stage_pause(void);
 void stage_gameover(void);
 
+// Seek the replay being played back to [frame]. Seeking backwards re-simulates the stage from its start.
+void stage_replay_seek(int frame);
+bool stage_is_replay_seeking(void);
+
 void stage_start_bgm(const char *bgm);
 
 typedef enum ClearHazardsFlags {
@@ -65,6 +65,7 @@ static struct {
 
 	bool framerate_graphs;
 	bool objpool_stats;
+	bool deferred_particle_batching;
 
 	#ifdef DEBUG
 		Sprite dummy;
@@ -330,6 +331,24 @@ void stage_draw_pre_init(void) {
 	}
 }
 
+// Particles within these layers are drawn with deferred sprite batching, if enabled.
+// Their relative order is not preserved, which is usually hard to notice with particles.
+static const DrawLayerID deferred_batching_layers[] = {
+	LAYER_ID_PARTICLE_LOW,
+	LAYER_ID_PARTICLE_MID,
+	LAYER_ID_PARTICLE_BULLET_CLEAR,
+	LAYER_ID_PARTICLE_PETAL,
+	LAYER_ID_PARTICLE_HIGH,
+};
+
+static void stage_draw_begin_deferred_batching(void *arg) {
+	r_sprite_batch_begin_deferred();
+}
+
+static void stage_draw_end_deferred_batching(void *arg) {
+	r_sprite_batch_end_deferred();
+}
+
 void stage_draw_init(void) {
 	stagedraw.viewport_pp = get_resource_data(RES_POSTPROCESS, "viewport", RESF_OPTIONAL);
 	stagedraw.hud_text.shader = res_shader("text_hud");
@@ -355,9 +374,32 @@ void stage_draw_init(void) {
 	});
 
 	COEVENT_INIT_ARRAY(stagedraw.events);
+
+	stagedraw.deferred_particle_batching = env_get("TAISEI_DEFERRED_SPRITE_BATCHING", false);
+
+	if(stagedraw.deferred_particle_batching) {
+		for(uint i = 0; i < ARRAY_SIZE(deferred_batching_layers); ++i) {
+			ent_hook_layer_draw_pass(
+				deferred_batching_layers[i],
+				stage_draw_begin_deferred_batching,
+				stage_draw_end_deferred_batching,
+				NULL
+			);
+		}
+	}
 }
 
 void stage_draw_shutdown(void) {
+	if(stagedraw.deferred_particle_batching) {
+		for(uint i = 0; i < ARRAY_SIZE(deferred_batching_layers); ++i) {
+			ent_unhook_layer_draw_pass(
+				deferred_batching_layers[i],
+				stage_draw_begin_deferred_batching,
+				stage_draw_end_deferred_batching
+			);
+		}
+	}
+
 	COEVENT_CANCEL_ARRAY(stagedraw.events);
 	events_unregister_handler(stage_draw_event);
 	stage_draw_destroy_framebuffers();
@@ -12,16 +12,40 @@
 #include "list.h"
 #include "util.h"
 
+// Max. number of released Task objects kept around for reuse
+#define TASK_POOL_MAX 256
+
+typedef struct TaskQueue {
+	LIST_ANCHOR(Task) tasks;
+	SDL_mutex *mutex;
+	SDL_atomic_t size;
+} TaskQueue;
+
+typedef struct TaskWorker {
+	TaskManager *mgr;
+	SDL_Thread *thread;
+	TaskQueue queue;
+	uint index;
+} TaskWorker;
+
 struct TaskManager {
-	LIST_ANCHOR(Task) queue;
+	// These are only used to put idle workers to sleep and to wake them up.
 	SDL_mutex *mutex;
 	SDL_cond *cond;
+	SDL_atomic_t numsleeping;
+
+	// Number of tasks sitting in the worker queues
+	SDL_atomic_t numqueued;
+
+	// Number of tasks that haven't been removed from the queues yet (see taskmgr_remaining)
+	SDL_atomic_t numtasks;
+
+	SDL_atomic_t next_worker;
 	uint numthreads;
 	uint running : 1;
 	uint aborted : 1;
-	SDL_atomic_t numtasks;
 	SDL_ThreadPriority thread_prio;
-	SDL_Thread *threads[];
+	TaskWorker workers[];
 };
 
 struct Task {
@@ -30,8 +54,7 @@ struct Task {
 	task_free_func_t userdata_free_callback;
 	void *userdata;
 	int prio;
-	SDL_mutex *mutex;
-	SDL_cond *cond;
+	SDL_SpinLock lock;
 	TaskStatus status;
 	void *result;
 	uint disowned : 1;
@@ -40,7 +63,108 @@ struct Task {
 
 static TaskManager *g_taskmgr;
 
+static struct {
+	LIST_ANCHOR(Task) tasks;
+	SDL_SpinLock lock;
+	uint num_tasks;
+} task_pool;
+
+/*
+ * Shared by all task managers, since a Task may outlive its manager. Broadcast whenever a task
+ * that someone may be waiting for stops running.
+ */
+static struct {
+	SDL_mutex *mutex;
+	SDL_cond *cond;
+	SDL_atomic_t numwaiters;
+	SDL_SpinLock init_lock;
+} task_completion;
+
+static bool task_completion_init(void) {
+	bool ok = true;
+
+	SDL_AtomicLock(&task_completion.init_lock);
+
+	if(!task_completion.mutex && !(task_completion.mutex = SDL_CreateMutex())) {
+		log_sdl_error(LOG_WARN, "SDL_CreateMutex");
+		ok = false;
+	}
+
+	if(ok && !task_completion.cond && !(task_completion.cond = SDL_CreateCond())) {
+		log_sdl_error(LOG_WARN, "SDL_CreateCond");
+		ok = false;
+	}
+
+	SDL_AtomicUnlock(&task_completion.init_lock);
+
+	return ok;
+}
+
+static void task_completion_shutdown(void) {
+	assert(SDL_AtomicGet(&task_completion.numwaiters) == 0);
+
+	SDL_AtomicLock(&task_completion.init_lock);
+
+	if(task_completion.cond) {
+		SDL_DestroyCond(task_completion.cond);
+		task_completion.cond = NULL;
+	}
+
+	if(task_completion.mutex) {
+		SDL_DestroyMutex(task_completion.mutex);
+		task_completion.mutex = NULL;
+	}
+
+	SDL_AtomicUnlock(&task_completion.init_lock);
+}
+
+static void task_completion_notify(void) {
+	// NOTE: SDL_AtomicAdd is a full barrier, so the status change made by the caller is visible to
+	// anyone who registered as a waiter before this point. See task_wait_running.
+	if(SDL_AtomicAdd(&task_completion.numwaiters, 0) > 0) {
+		SDL_LockMutex(task_completion.mutex);
+		SDL_CondBroadcast(task_completion.cond);
+		SDL_UnlockMutex(task_completion.mutex);
+	}
+}
+
+static Task *task_alloc(void) {
+	SDL_AtomicLock(&task_pool.lock);
+	Task *task = alist_pop(&task_pool.tasks);
+
+	if(task) {
+		--task_pool.num_tasks;
+	}
+
+	SDL_AtomicUnlock(&task_pool.lock);
+
+	if(task) {
+		memset(task, 0, sizeof(*task));
+	} else {
+		task = calloc(1, sizeof(*task));
+	}
+
+	return task;
+}
+
+static void task_pool_clear(void) {
+	SDL_AtomicLock(&task_pool.lock);
+
+	for(Task *task; (task = alist_pop(&task_pool.tasks));) {
+		free(task);
+	}
+
+	task_pool.num_tasks = 0;
+	SDL_AtomicUnlock(&task_pool.lock);
+}
+
 static void taskmgr_free(TaskManager *mgr) {
+	for(uint i = 0; i < mgr->numthreads; ++i) {
+		if(mgr->workers[i].queue.mutex != NULL) {
+			SDL_DestroyMutex(mgr->workers[i].queue.mutex);
+		}
+	}
+
 	if(mgr->mutex != NULL) {
 		SDL_DestroyMutex(mgr->mutex);
 	}
@@ -60,19 +184,83 @@ static void task_free(Task *task) {
 		task->userdata_free_callback(task->userdata);
 	}
 
-	if(task->mutex != NULL) {
-		SDL_DestroyMutex(task->mutex);
-	}
+	SDL_AtomicLock(&task_pool.lock);
 
-	if(task->cond != NULL) {
-		SDL_DestroyCond(task->cond);
+	if(task_pool.num_tasks < TASK_POOL_MAX) {
+		alist_push(&task_pool.tasks, task);
+		++task_pool.num_tasks;
+		task = NULL;
 	}
 
+	SDL_AtomicUnlock(&task_pool.lock);
+
 	free(task);
 }
 
+static Task *taskmgr_pop_task(TaskWorker *worker) {
+	TaskManager *mgr = worker->mgr;
+
+	// Try our own queue first, then steal from the others.
+	for(uint i = 0; i < mgr->numthreads; ++i) {
+		TaskQueue *q = &mgr->workers[(worker->index + i) % mgr->numthreads].queue;
+
+		if(SDL_AtomicGet(&q->size) == 0) {
+			continue;
+		}
+
+		SDL_LockMutex(q->mutex);
+		Task *task = alist_pop(&q->tasks);
+		SDL_UnlockMutex(q->mutex);
+
+		if(task != NULL) {
+			(void)SDL_AtomicDecRef(&q->size);
+			(void)SDL_AtomicDecRef(&mgr->numqueued);
+			return task;
+		}
+	}
+
+	return NULL;
+}
+
+static void taskmgr_process_task(TaskManager *mgr, Task *task) {
+	bool notify = false;
+
+	SDL_AtomicLock(&task->lock);
+
+	if(task->status == TASK_PENDING) {
+		task->status = TASK_RUNNING;
+
+		SDL_AtomicUnlock(&task->lock);
+		void *result = task->callback(task->userdata);
+		SDL_AtomicLock(&task->lock);
+
+		task->result = result;
+		task->status = TASK_FINISHED;
+		notify = true;
+	} else if(
+		task->status != TASK_CANCELLED &&
+		task->status != TASK_RUNNING &&
+		task->status != TASK_FINISHED
+	) {
+		UNREACHABLE;
+	}
+
+	assert(task->in_queue);
+	task->in_queue = false;
+	(void)SDL_AtomicDecRef(&mgr->numtasks);
+	bool task_disowned = task->disowned;
+	SDL_AtomicUnlock(&task->lock);
+
+	if(task_disowned) {
+		task_free(task);
+	} else if(notify) {
+		task_completion_notify();
+	}
+}
+
 static int taskmgr_thread(void *arg) {
-	TaskManager *mgr = arg;
+	TaskWorker *worker = arg;
+	TaskManager *mgr = worker->mgr;
 	attr_unused SDL_threadID tid = SDL_ThreadID();
 
 	if(SDL_SetThreadPriority(mgr->thread_prio) < 0) {
@@ -95,59 +283,32 @@ static int taskmgr_thread(void *arg) {
 		SDL_UnlockMutex(mgr->mutex);
 	} while(!running && !aborted);
 
-	while(!aborted) {
+	if(aborted) {
+		return 0;
+	}
+
+	for(;;) {
+		Task *task = taskmgr_pop_task(worker);
+
+		if(task != NULL) {
+			taskmgr_process_task(mgr, task);
+			continue;
+		}
+
 		SDL_LockMutex(mgr->mutex);
-		Task *task = alist_pop(&mgr->queue);
 
-		running = mgr->running;
-		aborted = mgr->aborted;
+		// NOTE: SDL_AtomicIncRef is a full barrier; see taskmgr_wake_workers.
+		SDL_AtomicIncRef(&mgr->numsleeping);
 
-		if(running && task == NULL && !aborted) {
+		while(mgr->running && SDL_AtomicGet(&mgr->numqueued) == 0) {
 			SDL_CondWait(mgr->cond, mgr->mutex);
 		}
 
+		(void)SDL_AtomicDecRef(&mgr->numsleeping);
+		running = mgr->running;
 		SDL_UnlockMutex(mgr->mutex);
 
-		if(task != NULL) {
-			SDL_LockMutex(task->mutex);
-
-			if(aborted && task->status == TASK_PENDING) {
-				task->status = TASK_CANCELLED;
-			}
-
-			if(task->status == TASK_PENDING) {
-				task->status = TASK_RUNNING;
-
-				SDL_UnlockMutex(task->mutex);
-				task->result = task->callback(task->userdata);
-				SDL_LockMutex(task->mutex);
-
-				assert(task->in_queue);
-				task->in_queue = false;
-				(void)SDL_AtomicDecRef(&mgr->numtasks);
-
-				if(task->disowned) {
-					SDL_UnlockMutex(task->mutex);
-					task_free(task);
-				} else {
-					task->status = TASK_FINISHED;
-					SDL_CondBroadcast(task->cond);
-					SDL_UnlockMutex(task->mutex);
-				}
-			} else if(task->status == TASK_CANCELLED || task->status == TASK_RUNNING || task->status == TASK_FINISHED) {
-				assert(task->in_queue);
-				task->in_queue = false;
-				(void)SDL_AtomicDecRef(&mgr->numtasks);
-				bool task_disowned = task->disowned;
-				SDL_UnlockMutex(task->mutex);
-
-				if(task_disowned) {
-					task_free(task);
-				}
-			} else {
-				UNREACHABLE;
-			}
-		} else if(!running) {
+		if(!running && SDL_AtomicGet(&mgr->numqueued) == 0) {
 			break;
 		}
 	}
@@ -172,7 +333,11 @@ TaskManager *taskmgr_create(uint numthreads, SDL_ThreadPriority prio, const char
 		numthreads = maxthreads;
 	}
 
-	TaskManager *mgr = calloc(1, sizeof(TaskManager) + numthreads * sizeof(SDL_Thread*));
+	if(!task_completion_init()) {
+		return NULL;
+	}
+
+	TaskManager *mgr = calloc(1, sizeof(TaskManager) + numthreads * sizeof(TaskWorker));
 
 	if(!(mgr->mutex = SDL_CreateMutex())) {
 		log_sdl_error(LOG_WARN, "SDL_CreateMutex");
@@ -187,24 +352,37 @@ TaskManager *taskmgr_create(uint numthreads, SDL_ThreadPriority prio, const char
 	mgr->numthreads = numthreads;
 	mgr->thread_prio = prio;
 
+	for(uint i = 0; i < numthreads; ++i) {
+		TaskWorker *worker = mgr->workers + i;
+		worker->mgr = mgr;
+		worker->index = i;
+
+		if(!(worker->queue.mutex = SDL_CreateMutex())) {
+			log_sdl_error(LOG_WARN, "SDL_CreateMutex");
+			goto fail;
+		}
+	}
+
 	for(uint i = 0; i < numthreads; ++i) {
 		int digits = i ? log10(i) + 1 : 0;
 		static const char *const prefix = "taskmgr";
 		char threadname[sizeof(prefix) + strlen(name) + digits + 2];
 		snprintf(threadname, sizeof(threadname), "%s:%s/%i", prefix, name, i);
 
-		if(!(mgr->threads[i] = SDL_CreateThread(taskmgr_thread, threadname, mgr))) {
+		if(!(mgr->workers[i].thread = SDL_CreateThread(taskmgr_thread, threadname, mgr->workers + i))) {
 			log_sdl_error(LOG_WARN, "SDL_CreateThread");
 
-			for(uint j = 0; j < i; ++j) {
-				SDL_DetachThread(mgr->threads[j]);
-				mgr->threads[j] = NULL;
-			}
-
 			SDL_LockMutex(mgr->mutex);
 			mgr->aborted = true;
 			SDL_CondBroadcast(mgr->cond);
 			SDL_UnlockMutex(mgr->mutex);
+
+			// The workers reference the manager, so they must exit before it can be freed.
+			for(uint j = 0; j < i; ++j) {
+				SDL_WaitThread(mgr->workers[j].thread, NULL);
+				mgr->workers[j].thread = NULL;
+			}
+
 			goto fail;
 		}
 	}
@@ -233,50 +411,106 @@ static int task_prio_func(List *ltask) {
 	return ((Task*)ltask)->prio;
 }
 
-Task *taskmgr_submit(TaskManager *mgr, TaskParams params) {
-	assert(params.callback != NULL);
+static Task *task_new(const TaskParams *params) {
+	assert(params->callback != NULL);
 
-	Task *task = calloc(1, sizeof(Task));
-	task->callback = params.callback;
-	task->userdata_free_callback = params.userdata_free_callback;
-	task->userdata = params.userdata;
-	task->prio = params.prio;
+	Task *task = task_alloc();
+	task->callback = params->callback;
+	task->userdata_free_callback = params->userdata_free_callback;
+	task->userdata = params->userdata;
+	task->prio = params->prio;
 	task->status = TASK_PENDING;
+	task->in_queue = true;
 
-	if(!(task->mutex = SDL_CreateMutex())) {
-		log_sdl_error(LOG_WARN, "SDL_CreateMutex");
-		goto fail;
+	return task;
+}
+
+static void taskmgr_wake_workers(TaskManager *mgr, uint num_tasks) {
+	// NOTE: SDL_AtomicAdd is a full barrier, so a worker that registers as sleeping after this
+	// point is guaranteed to see the updated numqueued, and won't go to sleep.
+	if(SDL_AtomicAdd(&mgr->numsleeping, 0) > 0) {
+		SDL_LockMutex(mgr->mutex);
+
+		if(num_tasks > 1) {
+			SDL_CondBroadcast(mgr->cond);
+		} else {
+			SDL_CondSignal(mgr->cond);
+		}
+
+		SDL_UnlockMutex(mgr->mutex);
 	}
+}
 
-	if(!(task->cond = SDL_CreateCond())) {
-		log_sdl_error(LOG_WARN, "SDL_CreateCond");
-		goto fail;
+uint taskmgr_submit_batch(TaskManager *mgr, uint num_tasks, const TaskParams params[num_tasks], Task *out_tasks[num_tasks]) {
+	if(num_tasks == 0) {
+		return 0;
 	}
 
-	SDL_LockMutex(mgr->mutex);
+	for(uint i = 0; i < num_tasks; ++i) {
+		out_tasks[i] = task_new(params + i);
+	}
 
-	if(params.topmost) {
-		alist_insert_at_priority_head(&mgr->queue, task, task->prio, task_prio_func);
-	} else {
-		alist_insert_at_priority_tail(&mgr->queue, task, task->prio, task_prio_func);
+	// Spread the batch over the worker queues, locking each of them at most once.
+	uint first_worker = (uint)SDL_AtomicAdd(&mgr->next_worker, num_tasks) % mgr->numthreads;
+	uint num_queues = umin(num_tasks, mgr->numthreads);
+
+	for(uint q = 0; q < num_queues; ++q) {
+		TaskQueue *queue = &mgr->workers[(first_worker + q) % mgr->numthreads].queue;
+		uint num_in_queue = (num_tasks - q + num_queues - 1) / num_queues;
+
+		SDL_AtomicAdd(&mgr->numtasks, num_in_queue);
+		SDL_AtomicAdd(&mgr->numqueued, num_in_queue);
+		SDL_AtomicAdd(&queue->size, num_in_queue);
+
+		SDL_LockMutex(queue->mutex);
+
+		for(uint i = q; i < num_tasks; i += num_queues) {
+			Task *task = out_tasks[i];
+
+			if(params[i].topmost) {
+				alist_insert_at_priority_head(&queue->tasks, task, task->prio, task_prio_func);
+			} else {
+				alist_insert_at_priority_tail(&queue->tasks, task, task->prio, task_prio_func);
+			}
+		}
+
+		SDL_UnlockMutex(queue->mutex);
 	}
 
-	task->in_queue = true;
-	SDL_AtomicIncRef(&mgr->numtasks);
-	SDL_CondSignal(mgr->cond);
-	SDL_UnlockMutex(mgr->mutex);
+	taskmgr_wake_workers(mgr, num_tasks);
 
-	return task;
+	return num_tasks;
+}
 
-fail:
-	task_free(task);
-	return NULL;
+Task *taskmgr_submit(TaskManager *mgr, TaskParams params) {
+	Task *task;
+	taskmgr_submit_batch(mgr, 1, &params, &task);
+	return task;
 }
 
 uint taskmgr_remaining(TaskManager *mgr) {
 	return SDL_AtomicGet(&mgr->numtasks);
 }
 
+static void taskmgr_cancel_pending(TaskManager *mgr) {
+	for(uint i = 0; i < mgr->numthreads; ++i) {
+		TaskQueue *q = &mgr->workers[i].queue;
+		SDL_LockMutex(q->mutex);
+
+		for(Task *task = q->tasks.first; task; task = task->next) {
+			SDL_AtomicLock(&task->lock);
+
+			if(task->status == TASK_PENDING) {
+				task->status = TASK_CANCELLED;
+			}
+
+			SDL_AtomicUnlock(&task->lock);
+		}
+
+		SDL_UnlockMutex(q->mutex);
+	}
+}
+
 static void taskmgr_finalize_and_wait(TaskManager *mgr, bool do_abort) {
 	log_debug(
 		"%08lx [%p] waiting for %u tasks (abort = %i)",
@@ -289,16 +523,21 @@ static void taskmgr_finalize_and_wait(TaskManager *mgr, bool do_abort) {
 	assert(mgr->running);
 	assert(!mgr->aborted);
 
+	if(do_abort) {
+		// Cancelled tasks are still removed from the queues by the workers, as usual.
+		taskmgr_cancel_pending(mgr);
+	}
+
 	SDL_LockMutex(mgr->mutex);
 	mgr->running = false;
-	mgr->aborted = do_abort;
 	SDL_CondBroadcast(mgr->cond);
 	SDL_UnlockMutex(mgr->mutex);
 
 	for(uint i = 0; i < mgr->numthreads; ++i) {
-		SDL_WaitThread(mgr->threads[i], NULL);
+		SDL_WaitThread(mgr->workers[i].thread, NULL);
 	}
 
+	assert(SDL_AtomicGet(&mgr->numqueued) == 0);
 	taskmgr_free(mgr);
 }
 
@@ -314,9 +553,9 @@ TaskStatus task_status(Task *task) {
 	TaskStatus result = TASK_INVALID;
 
 	if(task != NULL) {
-		SDL_LockMutex(task->mutex);
+		SDL_AtomicLock(&task->lock);
 		result = task->status;
-		SDL_UnlockMutex(task->mutex);
+		SDL_AtomicUnlock(&task->lock);
 	}
 
 	return result;
@@ -325,18 +564,39 @@ TaskStatus task_status(Task *task) {
 static void *task_offload(Task *task) {
 	assert(task->status == TASK_PENDING);
 	task->status = TASK_RUNNING;
-	SDL_UnlockMutex(task->mutex);
+	SDL_AtomicUnlock(&task->lock);
 	void *result = task->callback(task->userdata);
-	SDL_LockMutex(task->mutex);
+	SDL_AtomicLock(&task->lock);
 	assert(!task->disowned);
 	task->status = TASK_FINISHED;
 	task->result = result;
-	SDL_CondBroadcast(task->cond);
 	return result;
 }
 
+static void task_wait_running(Task *task) {
+	// Called and returns with task->lock held.
+	SDL_AtomicUnlock(&task->lock);
+	SDL_LockMutex(task_completion.mutex);
+	SDL_AtomicIncRef(&task_completion.numwaiters);
+
+	for(;;) {
+		SDL_AtomicLock(&task->lock);
+
+		if(task->status != TASK_RUNNING) {
+			break;
+		}
+
+		SDL_AtomicUnlock(&task->lock);
+		SDL_CondWait(task_completion.cond, task_completion.mutex);
+	}
+
+	(void)SDL_AtomicDecRef(&task_completion.numwaiters);
+	SDL_UnlockMutex(task_completion.mutex);
+}
+
 bool task_wait(Task *task, void **result) {
 	bool success = false;
+	bool offloaded = false;
 
 	if(task == NULL) {
 		return success;
@@ -344,7 +604,7 @@ bool task_wait(Task *task, void **result) {
 
 	void *_result = NULL;
 
-	SDL_LockMutex(task->mutex);
+	SDL_AtomicLock(&task->lock);
 
 	if(task->status == TASK_CANCELLED) {
 		success = false;
@@ -352,18 +612,23 @@ bool task_wait(Task *task, void **result) {
 		success = true;
 		_result = task->result;
 	} else if(task->status == TASK_RUNNING) {
-		SDL_CondWait(task->cond, task->mutex);
+		task_wait_running(task);
 		_result = task->result;
 		success = (task->status == TASK_FINISHED);
 	} else if(task->status == TASK_PENDING) {
 		// fine, i'll do it myself
 		_result = task_offload(task);
 		success = true;
+		offloaded = true;
 	} else {
 		UNREACHABLE;
 	}
 
-	SDL_UnlockMutex(task->mutex);
+	SDL_AtomicUnlock(&task->lock);
+
+	if(offloaded) {
+		task_completion_notify();
+	}
 
 	if(success && result != NULL) {
 		*result = _result;
@@ -379,14 +644,14 @@ bool task_cancel(Task *task) {
 		return success;
 	}
 
-	SDL_LockMutex(task->mutex);
+	SDL_AtomicLock(&task->lock);
 
 	if(task->status == TASK_PENDING) {
 		task->status = TASK_CANCELLED;
 		success = true;
 	}
 
-	SDL_UnlockMutex(task->mutex);
+	SDL_AtomicUnlock(&task->lock);
 
 	return success;
 }
@@ -399,12 +664,12 @@ bool task_detach(Task *task) {
 		return success;
 	}
 
-	SDL_LockMutex(task->mutex);
+	SDL_AtomicLock(&task->lock);
 	assert(!task->disowned);
 	task->disowned = true;
 	task_in_queue = task->in_queue;
 	success = true;
-	SDL_UnlockMutex(task->mutex);
+	SDL_AtomicUnlock(&task->lock);
 
 	if(!task_in_queue) {
 		task_free(task);
@@ -435,17 +700,38 @@ void taskmgr_global_shutdown(void) {
 		taskmgr_finish(g_taskmgr);
 		g_taskmgr = NULL;
 	}
+
+	task_pool_clear();
+
+	// NOTE: this assumes no other task managers are alive by now, which is the case at exit.
+	task_completion_shutdown();
+}
+
+static Task *task_run_immediately(const TaskParams *params) {
+	Task *t = task_new(params);
+	t->in_queue = false;
+	t->status = TASK_RUNNING;
+	t->result = params->callback(params->userdata);
+	t->status = TASK_FINISHED;
+	return t;
 }
 
 Task *taskmgr_global_submit(TaskParams params) {
 	if(g_taskmgr == NULL) {
-		Task *t = calloc(1, sizeof(Task));
-		t->callback = params.callback;
-		t->userdata = params.userdata;
-		t->userdata_free_callback = params.userdata_free_callback;
-		t->result = params.callback(params.userdata);
-		return t;
+		return task_run_immediately(&params);
 	}
 
 	return taskmgr_submit(g_taskmgr, params);
 }
+
+uint taskmgr_global_submit_batch(uint num_tasks, const TaskParams params[num_tasks], Task *out_tasks[num_tasks]) {
+	if(g_taskmgr == NULL) {
+		for(uint i = 0; i < num_tasks; ++i) {
+			out_tasks[i] = task_run_immediately(params + i);
+		}
+
+		return num_tasks;
+	}
+
+	return taskmgr_submit_batch(g_taskmgr, num_tasks, params, out_tasks);
+}
@@ -56,6 +56,9 @@ typedef struct TaskParams {
 	 * to the queue ahead of the lower priority ones, and thus will start execute sooner. Note
 	 * that this affects only the pending tasks. A task that already began executing cannot be
 	 * interrupted, regardless of its priority.
+	 *
+	 * Every worker thread has its own queue, and idle workers steal tasks from the others, so
+	 * priorities are only strictly respected among the tasks of the same queue.
 	 */
 	int prio;
 
@@ -96,6 +99,17 @@ TaskManager *taskmgr_create(uint numthreads, SDL_ThreadPriority prio, const char
 Task *taskmgr_submit(TaskManager *mgr, TaskParams params)
 	attr_nonnull(1) attr_nodiscard attr_returns_max_aligned;
 
+/**
+ * Submit [num_tasks] tasks to [mgr] at once, described by [params]. The resulting Task pointers
+ * are stored in [out_tasks], in the same order. This is equivalent to calling `taskmgr_submit`
+ * for each of them, but much cheaper for large batches: the tasks are spread over the worker
+ * queues with a single lock acquisition per queue, and the workers are woken up only once.
+ *
+ * Returns the number of tasks successfully submitted.
+ */
+uint taskmgr_submit_batch(TaskManager *mgr, uint num_tasks, const TaskParams params[num_tasks], Task *out_tasks[num_tasks])
+	attr_nonnull(1);
+
 /**
  * Returns the number of remaining tasks in [mgr]'s queue.
  */
@@ -179,4 +193,9 @@ void taskmgr_global_shutdown(void);
  */
 Task *taskmgr_global_submit(TaskParams params);
 
+/**
+ * Submit a batch of tasks to the global task manager. See `taskmgr_submit_batch`.
+ */
+uint taskmgr_global_submit_batch(uint num_tasks, const TaskParams params[num_tasks], Task *out_tasks[num_tasks]);
+
 #endif // IGUARD_taskmanager_h
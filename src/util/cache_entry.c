@@ -0,0 +1,122 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "cache_entry.h"
+#include "log.h"
+#include "vfs/public.h"
+#include "assert.h"
+#include "rwops/rwops_crc32.h"
+
+#define CRC_INIT 0
+#define CRC_SIZE 4
+
+static void cache_entry_wrap(CacheEntry *entry, const char *path, SDL_RWops *file) {
+	entry->path = path;
+	entry->file = file;
+	entry->crc = CRC_INIT;
+	entry->rw = NOT_NULL(SDL_RWWrapCRC32(file, &entry->crc, false));
+}
+
+bool cache_entry_open_read(CacheEntry *entry, const char *path, uint32_t magic, uint8_t version) {
+	if(!vfs_query(path).exists) {
+		return false;
+	}
+
+	SDL_RWops *file = vfs_open(path, VFS_MODE_READ | VFS_MODE_SEEKABLE);
+
+	if(!file) {
+		log_error("VFS error: %s", vfs_get_error());
+		return false;
+	}
+
+	cache_entry_wrap(entry, path, file);
+
+	if(
+		SDL_ReadLE32(entry->rw) != magic ||
+		SDL_ReadU8(entry->rw) != version
+	) {
+		log_error("%s: Bad cache entry: header mismatch", path);
+		cache_entry_close(entry);
+		return false;
+	}
+
+	return true;
+}
+
+bool cache_entry_expect_payload(CacheEntry *entry, uint32_t payload_size) {
+	int64_t file_size = SDL_RWsize(entry->file);
+	int64_t pos = SDL_RWtell(entry->file);
+
+	if(file_size < 0 || pos < 0 || file_size != pos + (int64_t)payload_size + CRC_SIZE) {
+		log_error("%s: Bad cache entry: unexpected size", entry->path);
+		return false;
+	}
+
+	return true;
+}
+
+bool cache_entry_read_payload(CacheEntry *entry, uint32_t payload_size, void *payload) {
+	if(SDL_RWread(entry->rw, payload, payload_size, 1) != 1) {
+		log_error("%s: Read error", entry->path);
+		return false;
+	}
+
+	// Read the trailer directly from the file, so that it's not included in the CRC.
+	uint32_t file_crc = SDL_ReadLE32(entry->file);
+
+	if(entry->crc != file_crc) {
+		log_error("%s: CRC mismatch (%08x != %08x), cache entry is corrupted", entry->path, entry->crc, file_crc);
+		return false;
+	}
+
+	return true;
+}
+
+void cache_entry_close(CacheEntry *entry) {
+	SDL_RWclose(entry->rw);
+	SDL_RWclose(entry->file);
+	entry->rw = entry->file = NULL;
+}
+
+bool cache_entry_open_write(CacheEntry *entry, const char *path, uint32_t magic, uint8_t version) {
+	if(!vfs_mkparents(path)) {
+		log_error("VFS error: %s", vfs_get_error());
+		return false;
+	}
+
+	SDL_RWops *file = vfs_open(path, VFS_MODE_WRITE);
+
+	if(!file) {
+		log_error("VFS error: %s", vfs_get_error());
+		return false;
+	}
+
+	cache_entry_wrap(entry, path, file);
+	SDL_WriteLE32(entry->rw, magic);
+	SDL_WriteU8(entry->rw, version);
+
+	return true;
+}
+
+bool cache_entry_finish_write(CacheEntry *entry, uint32_t payload_size, const void *payload) {
+	bool ok = SDL_RWwrite(entry->rw, payload, payload_size, 1) == 1;
+	SDL_RWclose(entry->rw);
+
+	ok = ok && SDL_WriteLE32(entry->file, entry->crc) == 1;
+	SDL_RWclose(entry->file);
+	entry->rw = entry->file = NULL;
+
+	if(!ok) {
+		// The truncated entry will be rejected and overwritten next time.
+		log_error("%s: Write error", entry->path);
+	}
+
+	return ok;
+}
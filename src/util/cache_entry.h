@@ -0,0 +1,67 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#ifndef IGUARD_util_cache_entry_h
+#define IGUARD_util_cache_entry_h
+
+#include "taisei.h"
+
+#include <SDL.h>
+
+/*
+ * A simple on-disk cache entry: a magic number and a format version, followed by caller-defined
+ * header fields and a payload, followed by a CRC32 of everything before it.
+ *
+ * The header fields are read and written through `rw`, which keeps the CRC up to date.
+ *
+ * FIXME: Entries are not written atomically. A partially written entry is caught by the size
+ * and CRC checks, though.
+ */
+typedef struct CacheEntry {
+	SDL_RWops *rw;
+	SDL_RWops *file;
+	const char *path;
+	uint32_t crc;
+} CacheEntry;
+
+/*
+ * Opens the entry at `path` and checks its magic and version.
+ * Returns false if it doesn't exist or is unusable; in that case `entry` must not be closed.
+ */
+bool cache_entry_open_read(CacheEntry *entry, const char *path, uint32_t magic, uint8_t version)
+	attr_nonnull_all attr_nodiscard;
+
+/*
+ * Checks that exactly `payload_size` bytes of payload follow the header fields read so far.
+ */
+bool cache_entry_expect_payload(CacheEntry *entry, uint32_t payload_size)
+	attr_nonnull_all attr_nodiscard;
+
+/*
+ * Reads the payload and verifies the CRC of the whole entry.
+ */
+bool cache_entry_read_payload(CacheEntry *entry, uint32_t payload_size, void *payload)
+	attr_nonnull_all attr_nodiscard;
+
+void cache_entry_close(CacheEntry *entry)
+	attr_nonnull_all;
+
+/*
+ * Creates the entry at `path`, and writes its magic and version.
+ * Returns false on failure; in that case `entry` must not be finished.
+ */
+bool cache_entry_open_write(CacheEntry *entry, const char *path, uint32_t magic, uint8_t version)
+	attr_nonnull_all attr_nodiscard;
+
+/*
+ * Writes the payload and the CRC trailer, then closes the entry.
+ */
+bool cache_entry_finish_write(CacheEntry *entry, uint32_t payload_size, const void *payload)
+	attr_nonnull_all;
+
+#endif // IGUARD_util_cache_entry_h
@@ -98,7 +98,13 @@ bool vfs_node_mount(VFSNode *mountroot, const char *subname, VFSNode *mountee) {
 		return false;
 	}
 
-	return mountroot->funcs->mount(mountroot, subname, mountee);
+	bool ok = mountroot->funcs->mount(mountroot, subname, mountee);
+
+	if(ok) {
+		vfs_invalidate_lookup_caches();
+	}
+
+	return ok;
 }
 
 bool vfs_node_unmount(VFSNode *mountroot, const char *subname) {
@@ -109,7 +115,13 @@ bool vfs_node_unmount(VFSNode *mountroot, const char *subname) {
 		return false;
 	}
 
-	return mountroot->funcs->unmount(mountroot, subname);
+	bool ok = mountroot->funcs->unmount(mountroot, subname);
+
+	if(ok) {
+		vfs_invalidate_lookup_caches();
+	}
+
+	return ok;
 }
 
 bool vfs_node_mkdir(VFSNode *parent, const char *subdir) {
@@ -120,7 +132,21 @@ bool vfs_node_mkdir(VFSNode *parent, const char *subdir) {
 		return false;
 	}
 
-	return parent->funcs->mkdir(parent, subdir);
+	// NOTE: Creating a directory that already exists is not an error, but doesn't change anything.
+	VFSNode *dir = subdir ? vfs_node_locate(parent, subdir) : parent;
+	bool existed = dir && vfs_node_query(dir).exists;
+
+	if(dir && dir != parent) {
+		vfs_decref(dir);
+	}
+
+	bool ok = parent->funcs->mkdir(parent, subdir);
+
+	if(ok && !existed) {
+		vfs_invalidate_lookup_caches();
+	}
+
+	return ok;
 }
 
 SDL_RWops* vfs_node_open(VFSNode *filenode, VFSOpenMode mode) {
@@ -131,12 +157,17 @@ SDL_RWops* vfs_node_open(VFSNode *filenode, VFSOpenMode mode) {
 		return NULL;
 	}
 
+	bool created = (mode & VFS_MODE_WRITE) && !vfs_node_query(filenode).exists;
 	SDL_RWops *stream = filenode->funcs->open(filenode, mode);
 
 	if(!stream) {
 		return NULL;
 	}
 
+	if(created) {
+		vfs_invalidate_lookup_caches();
+	}
+
 	if(!(mode & VFS_MODE_WRITE) && !vfs_node_query(filenode).is_readonly) {
 		stream = SDL_RWWrapReadOnly(stream, true);
 	}
@@ -24,6 +24,7 @@ typedef struct vfs_shutdownhook_t {
 } vfs_shutdownhook_t;
 
 static SDL_TLSID vfs_tls_id;
+static SDL_atomic_t vfs_lookup_generation;
 static vfs_tls_t *vfs_tls_fallback;
 static vfs_shutdownhook_t *shutdown_hooks;
 
@@ -95,6 +96,14 @@ void vfs_hook_on_shutdown(VFSShutdownHandler func, void *arg) {
 	list_append(&shutdown_hooks, hook);
 }
 
+uint vfs_lookup_cache_generation(void) {
+	return SDL_AtomicGet(&vfs_lookup_generation);
+}
+
+void vfs_invalidate_lookup_caches(void) {
+	SDL_AtomicIncRef(&vfs_lookup_generation);
+}
+
 VFSNode* vfs_alloc(void) {
 	VFSNode *node = calloc(1, sizeof(VFSNode));
 	vfs_incref(node);
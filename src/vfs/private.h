@@ -70,6 +70,13 @@ bool vfs_node_mkdir(VFSNode *parent, const char *subdir) attr_nonnull(1);
 SDL_RWops* vfs_node_open(VFSNode *filenode, VFSOpenMode mode) attr_nonnull(1) attr_nodiscard;
 
 void vfs_hook_on_shutdown(VFSShutdownHandler, void *arg);
+
+// Incremented whenever the tree changes in a way that may affect path lookups:
+// (un)mounting, creating directories or files. Nodes that cache lookup results
+// must discard them when this changes.
+uint vfs_lookup_cache_generation(void);
+void vfs_invalidate_lookup_caches(void);
+
 void vfs_print_tree_recurse(SDL_RWops *dest, VFSNode *root, char *prefix, const char *name) attr_nonnull(1, 2, 3, 4);
 
 #endif // IGUARD_vfs_private_h
@@ -17,4 +17,13 @@
 extern char *vfs_syspath_separators;
 bool vfs_syspath_init(VFSNode *node, const char *path);
 
+typedef struct VFSSyspathMapping {
+	const uint8_t *data;
+	size_t size;
+} VFSSyspathMapping;
+
+// Maps a whole file into memory, read-only. Fails if the platform doesn't support it.
+bool vfs_syspath_map_file(const char *path, VFSSyspathMapping *mapping) attr_nonnull_all attr_nodiscard;
+void vfs_syspath_unmap_file(VFSSyspathMapping *mapping) attr_nonnull_all;
+
 #endif // IGUARD_vfs_syspath_h
@@ -13,6 +13,12 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+
+#if !defined(__EMSCRIPTEN__) && !defined(__SWITCH__)
+	#include <sys/mman.h>
+	#define HAVE_MMAP
+#endif
 
 #include "syspath.h"
 
@@ -184,3 +190,48 @@ bool vfs_syspath_init(VFSNode *node, const char *path) {
 	vfs_syspath_init_internal(node, strdup(path));
 	return true;
 }
+
+bool vfs_syspath_map_file(const char *path, VFSSyspathMapping *mapping) {
+#ifdef HAVE_MMAP
+	int fd = open(path, O_RDONLY);
+
+	if(fd < 0) {
+		vfs_set_error("Can't open %s (errno: %i)", path, errno);
+		return false;
+	}
+
+	struct stat fstat_buf;
+
+	if(fstat(fd, &fstat_buf) < 0 || fstat_buf.st_size <= 0 || fstat_buf.st_size > SIZE_MAX) {
+		vfs_set_error("Can't map %s: bad file size", path);
+		close(fd);
+		return false;
+	}
+
+	void *data = mmap(NULL, fstat_buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(data == MAP_FAILED) {
+		vfs_set_error("Can't map %s (errno: %i)", path, errno);
+		return false;
+	}
+
+	mapping->data = data;
+	mapping->size = fstat_buf.st_size;
+	return true;
+#else
+	vfs_set_error("Memory-mapped files are not supported on this platform");
+	return false;
+#endif
+}
+
+void vfs_syspath_unmap_file(VFSSyspathMapping *mapping) {
+#ifdef HAVE_MMAP
+	if(mapping->data) {
+		munmap((void*)mapping->data, mapping->size);
+	}
+#endif
+
+	mapping->data = NULL;
+	mapping->size = 0;
+}
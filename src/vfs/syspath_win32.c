@@ -308,3 +308,52 @@ static bool vfs_syspath_init_internal(VFSNode *node, char *path) {
 bool vfs_syspath_init(VFSNode *node, const char *path) {
 	return vfs_syspath_init_internal(node, strdup(path));
 }
+
+bool vfs_syspath_map_file(const char *path, VFSSyspathMapping *mapping) {
+	wchar_t *wpath = WIN_UTF8ToString(path);
+	HANDLE file = CreateFile(wpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	free(wpath);
+
+	if(file == INVALID_HANDLE_VALUE) {
+		vfs_set_error_win32();
+		return false;
+	}
+
+	LARGE_INTEGER size;
+
+	if(!GetFileSizeEx(file, &size) || size.QuadPart <= 0 || size.QuadPart > SIZE_MAX) {
+		vfs_set_error("Can't map %s: bad file size", path);
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE fmap = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+
+	if(!fmap) {
+		vfs_set_error_win32();
+		return false;
+	}
+
+	// NOTE: The view keeps the mapping object alive.
+	void *data = MapViewOfFile(fmap, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(fmap);
+
+	if(!data) {
+		vfs_set_error_win32();
+		return false;
+	}
+
+	mapping->data = data;
+	mapping->size = size.QuadPart;
+	return true;
+}
+
+void vfs_syspath_unmap_file(VFSSyspathMapping *mapping) {
+	if(mapping->data) {
+		UnmapViewOfFile(mapping->data);
+	}
+
+	mapping->data = NULL;
+	mapping->size = 0;
+}
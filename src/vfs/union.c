@@ -10,11 +10,50 @@
 
 #include "union.h"
 
-#define _members_ data1
-#define _primary_member_ data2
+typedef struct VFSUnionData {
+	ListContainer *members;
+	VFSNode *primary_member;
+
+	// Maps paths to the results of vfs_union_locate, including failures (NULL).
+	// Holds a reference to every cached node.
+	struct {
+		ht_str2ptr_t table;
+		SDL_mutex *mutex;
+		uint generation;
+		SDL_SpinLock init_lock;
+		bool initialized;
+	} lookup_cache;
+} VFSUnionData;
+
+#define UNION_DATA(n) ((VFSUnionData*)(n)->data1)
 
 static bool vfs_union_mount_internal(VFSNode *unode, const char *mountpoint, VFSNode *mountee, VFSInfo info, bool seterror);
 
+static void *vfs_union_decref_cached(const char *key, void *data, void *arg) {
+	vfs_decref(data);
+	return NULL;
+}
+
+static void vfs_union_flush_lookup_cache(VFSUnionData *udata) {
+	ht_foreach(&udata->lookup_cache.table, vfs_union_decref_cached, NULL);
+	ht_unset_all(&udata->lookup_cache.table);
+}
+
+static void vfs_union_init_lookup_cache(VFSUnionData *udata) {
+	// NOTE: Initialized lazily, since most temporary unions created by vfs_union_locate are
+	// never searched.
+	SDL_AtomicLock(&udata->lookup_cache.init_lock);
+
+	if(!udata->lookup_cache.initialized) {
+		ht_create(&udata->lookup_cache.table);
+		udata->lookup_cache.mutex = SDL_CreateMutex();
+		udata->lookup_cache.generation = vfs_lookup_cache_generation();
+		udata->lookup_cache.initialized = true;
+	}
+
+	SDL_AtomicUnlock(&udata->lookup_cache.init_lock);
+}
+
 static void* vfs_union_delete_callback(List **list, List *elem, void *arg) {
 	ListContainer *c = (ListContainer*)elem;
 	VFSNode *n = c->data;
@@ -24,15 +63,24 @@ static void* vfs_union_delete_callback(List **list, List *elem, void *arg) {
 }
 
 static void vfs_union_free(VFSNode *node) {
-	list_foreach((ListContainer**)&node->_members_, vfs_union_delete_callback, NULL);
+	VFSUnionData *udata = UNION_DATA(node);
+
+	if(udata->lookup_cache.initialized) {
+		vfs_union_flush_lookup_cache(udata);
+		ht_destroy(&udata->lookup_cache.table);
+		SDL_DestroyMutex(udata->lookup_cache.mutex);
+	}
+
+	list_foreach(&udata->members, vfs_union_delete_callback, NULL);
+	free(udata);
 }
 
-static VFSNode* vfs_union_locate(VFSNode *node, const char *path) {
+static VFSNode* vfs_union_locate_uncached(VFSNode *node, const char *path) {
 	VFSNode *u = vfs_alloc();
 	vfs_union_init(u); // uniception!
 
 	VFSInfo prim_info = VFSINFO_ERROR;
-	ListContainer *first = node->_members_;
+	ListContainer *first = UNION_DATA(node)->members;
 	ListContainer *last = first;
 	ListContainer *c;
 
@@ -55,11 +103,13 @@ static VFSNode* vfs_union_locate(VFSNode *node, const char *path) {
 		}
 	}
 
-	if(u->_primary_member_) {
-		if(!((List*)(u->_members_))->next || !prim_info.is_dir) {
+	VFSUnionData *udata = UNION_DATA(u);
+
+	if(udata->primary_member) {
+		if(!udata->members->next || !prim_info.is_dir) {
 			// the temporary union contains just one member, or doesn't represent a directory
 			// in those cases it's just a useless wrapper, so let's just return the primary member directly
-			VFSNode *n = u->_primary_member_;
+			VFSNode *n = udata->primary_member;
 
 			// incref primary member to keep it alive
 			vfs_incref(n);
@@ -79,6 +129,60 @@ static VFSNode* vfs_union_locate(VFSNode *node, const char *path) {
 	return u;
 }
 
+static VFSNode* vfs_union_locate(VFSNode *node, const char *path) {
+	// Resources are often located by the same path many times, and missing paths are probed
+	// for fallback extensions. Without a cache, every one of those queries every member.
+
+	VFSUnionData *udata = UNION_DATA(node);
+	uint generation = vfs_lookup_cache_generation();
+	VFSNode *result;
+
+	vfs_union_init_lookup_cache(udata);
+	SDL_LockMutex(udata->lookup_cache.mutex);
+
+	if(udata->lookup_cache.generation != generation) {
+		vfs_union_flush_lookup_cache(udata);
+		udata->lookup_cache.generation = generation;
+	}
+
+	if(ht_lookup(&udata->lookup_cache.table, path, (void**)&result)) {
+		if(result) {
+			vfs_incref(result);
+		} else {
+			vfs_set_error("Path '%s' not found in union", path);
+		}
+
+		SDL_UnlockMutex(udata->lookup_cache.mutex);
+		return result;
+	}
+
+	SDL_UnlockMutex(udata->lookup_cache.mutex);
+
+	result = vfs_union_locate_uncached(node, path);
+
+	SDL_LockMutex(udata->lookup_cache.mutex);
+
+	// Don't cache anything if the tree was modified while we were looking,
+	// the result may already be stale.
+	if(
+		udata->lookup_cache.generation == generation &&
+		vfs_lookup_cache_generation() == generation
+	) {
+		if(result) {
+			vfs_incref(result);
+		}
+
+		if(!ht_try_set(&udata->lookup_cache.table, path, result, NULL, NULL)) {
+			// Another thread got here first.
+			vfs_decref(result);
+		}
+	}
+
+	SDL_UnlockMutex(udata->lookup_cache.mutex);
+
+	return result;
+}
+
 typedef struct VFSUnionIterData {
 	ht_str2int_t visited; // XXX: this may not be the most efficient implementation of a "set" structure...
 	ListContainer *current;
@@ -91,7 +195,7 @@ static const char* vfs_union_iter(VFSNode *node, void **opaque) {
 
 	if(!i) {
 		i = malloc(sizeof(VFSUnionIterData));
-		i->current = node->_members_;
+		i->current = UNION_DATA(node)->members;
 		i->opaque = NULL;
 		ht_create(&i->visited);
 		*opaque = i;
@@ -131,8 +235,10 @@ static void vfs_union_iter_stop(VFSNode *node, void **opaque) {
 }
 
 static VFSInfo vfs_union_query(VFSNode *node) {
-	if(node->_primary_member_) {
-		VFSInfo i = vfs_node_query(node->_primary_member_);
+	VFSNode *n = UNION_DATA(node)->primary_member;
+
+	if(n) {
+		VFSInfo i = vfs_node_query(n);
 		// can't trust the primary member here, others might be writable'
 		i.is_readonly = false;
 		return i;
@@ -160,8 +266,9 @@ static bool vfs_union_mount_internal(VFSNode *unode, const char *mountpoint, VFS
 		return false;
 	}
 
-	list_push((ListContainer**)&unode->_members_, list_wrap_container(mountee));
-	unode->_primary_member_ = mountee;
+	VFSUnionData *udata = UNION_DATA(unode);
+	list_push(&udata->members, list_wrap_container(mountee));
+	udata->primary_member = mountee;
 
 	return true;
 }
@@ -176,7 +283,7 @@ static bool vfs_union_mount(VFSNode *unode, const char *mountpoint, VFSNode *mou
 }
 
 static SDL_RWops* vfs_union_open(VFSNode *unode, VFSOpenMode mode) {
-	VFSNode *n = unode->_primary_member_;
+	VFSNode *n = UNION_DATA(unode)->primary_member;
 
 	if(n) {
 		return vfs_node_open(n, mode);
@@ -190,7 +297,7 @@ static SDL_RWops* vfs_union_open(VFSNode *unode, VFSOpenMode mode) {
 static char* vfs_union_repr(VFSNode *node) {
 	char *mlist = strdup("union: "), *r;
 
-	for(ListContainer *c = node->_members_; c; c = c->next) {
+	for(ListContainer *c = UNION_DATA(node)->members; c; c = c->next) {
 		VFSNode *n = c->data;
 
 		strappend(&mlist, r = vfs_node_repr(n, false));
@@ -205,7 +312,7 @@ static char* vfs_union_repr(VFSNode *node) {
 }
 
 static char* vfs_union_syspath(VFSNode *node) {
-	VFSNode *n = node->_primary_member_;
+	VFSNode *n = UNION_DATA(node)->primary_member;
 
 	if(n) {
 		return vfs_node_syspath(n);
@@ -216,7 +323,7 @@ static char* vfs_union_syspath(VFSNode *node) {
 }
 
 static bool vfs_union_mkdir(VFSNode *node, const char *subdir) {
-	VFSNode *n = node->_primary_member_;
+	VFSNode *n = UNION_DATA(node)->primary_member;
 
 	if(n) {
 		return vfs_node_mkdir(n, subdir);
@@ -240,6 +347,8 @@ static VFSNodeFuncs vfs_funcs_union = {
 };
 
 void vfs_union_init(VFSNode *node) {
+	VFSUnionData *udata = calloc(1, sizeof(*udata));
 	node->funcs = &vfs_funcs_union;
-	node->data1 = node->data2 = NULL;
+	node->data1 = udata;
+	node->data2 = NULL;
 }
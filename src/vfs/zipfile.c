@@ -13,6 +13,16 @@
 
 #define LOG_SDL_ERROR log_debug("SDL error: %s", SDL_GetError())
 
+#define ZIP_EOCD_SIGNATURE 0x06054b50
+#define ZIP_CDIR_SIGNATURE 0x02014b50
+#define ZIP_LOCAL_SIGNATURE 0x04034b50
+
+#define ZIP_EOCD_SIZE 22
+#define ZIP_CDIR_ENTRY_SIZE 46
+#define ZIP_LOCAL_HEADER_SIZE 30
+
+#define ZIP_FLAG_ENCRYPTED 0x0001
+
 static zip_int64_t vfs_zipfile_srcfunc(void *userdata, void *data, zip_uint64_t len, zip_source_cmd_t cmd) {
 	VFSNode *zipnode = userdata;
 	VFSZipFileData *zdata = zipnode->data1;
@@ -149,6 +159,8 @@ static void vfs_zipfile_free(VFSNode *node) {
 				vfs_decref(zdata->source);
 			}
 
+			vfs_syspath_unmap_file(&zdata->mapping.file);
+			free(zdata->mapping.data_offsets);
 			ht_destroy(&zdata->pathmap);
 			free(zdata);
 		}
@@ -302,6 +314,159 @@ static void vfs_zipfile_init_pathmap(VFSNode *node) {
 	}
 }
 
+static inline uint16_t zip_read_le16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t zip_read_le32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool vfs_zipfile_index_mapping(VFSZipFileData *zdata, VFSZipFileTLS *tls) {
+	const uint8_t *data = zdata->mapping.file.data;
+	size_t size = zdata->mapping.file.size;
+	zip_int64_t num = zip_get_num_entries(tls->zip, 0);
+
+	if(size < ZIP_EOCD_SIZE || num <= 0) {
+		return false;
+	}
+
+	// The end of central directory record may be followed by a comment of up to 64K
+	const uint8_t *eocd = NULL;
+	size_t search_end = size - ZIP_EOCD_SIZE;
+	size_t search_start = search_end > UINT16_MAX ? search_end - UINT16_MAX : 0;
+
+	for(size_t i = search_end + 1; i-- > search_start;) {
+		if(zip_read_le32(data + i) == ZIP_EOCD_SIGNATURE) {
+			eocd = data + i;
+			break;
+		}
+	}
+
+	if(!eocd) {
+		return false;
+	}
+
+	uint16_t disk_num = zip_read_le16(eocd + 4);
+	uint16_t cdir_disk_num = zip_read_le16(eocd + 6);
+	uint16_t num_entries = zip_read_le16(eocd + 10);
+	uint32_t cdir_size = zip_read_le32(eocd + 12);
+	uint32_t cdir_offset = zip_read_le32(eocd + 16);
+
+	// Multi-disk and zip64 archives are left to libzip.
+	if(
+		disk_num != 0 || cdir_disk_num != 0 ||
+		num_entries != num ||
+		(uint64_t)cdir_offset + cdir_size > size
+	) {
+		return false;
+	}
+
+	uint64_t *offsets = calloc(num, sizeof(*offsets));
+	const uint8_t *p = data + cdir_offset;
+	const uint8_t *end = p + cdir_size;
+
+	for(zip_int64_t i = 0; i < num; ++i) {
+		if(end - p < ZIP_CDIR_ENTRY_SIZE || zip_read_le32(p) != ZIP_CDIR_SIGNATURE) {
+			goto fail;
+		}
+
+		uint16_t flags = zip_read_le16(p + 8);
+		uint16_t method = zip_read_le16(p + 10);
+		uint32_t comp_size = zip_read_le32(p + 20);
+		uint32_t uncomp_size = zip_read_le32(p + 24);
+		uint16_t name_len = zip_read_le16(p + 28);
+		size_t entry_size = ZIP_CDIR_ENTRY_SIZE + name_len + zip_read_le16(p + 30) + zip_read_le16(p + 32);
+		uint32_t local_offset = zip_read_le32(p + 42);
+
+		if(end - p < entry_size) {
+			goto fail;
+		}
+
+		// Our indices must agree with libzip's
+		const char *name = zip_get_name(tls->zip, i, ZIP_FL_ENC_RAW);
+
+		if(!name || strlen(name) != name_len || memcmp(name, p + ZIP_CDIR_ENTRY_SIZE, name_len)) {
+			goto fail;
+		}
+
+		p += entry_size;
+
+		if(
+			method != ZIP_CM_STORE ||
+			(flags & ZIP_FLAG_ENCRYPTED) ||
+			comp_size != uncomp_size ||
+			comp_size == UINT32_MAX ||
+			local_offset == UINT32_MAX ||
+			(uint64_t)local_offset + ZIP_LOCAL_HEADER_SIZE > size
+		) {
+			continue;
+		}
+
+		const uint8_t *local = data + local_offset;
+
+		if(zip_read_le32(local) != ZIP_LOCAL_SIGNATURE) {
+			continue;
+		}
+
+		uint64_t data_offset = (uint64_t)local_offset + ZIP_LOCAL_HEADER_SIZE + zip_read_le16(local + 26) + zip_read_le16(local + 28);
+
+		if(data_offset + comp_size <= size) {
+			offsets[i] = data_offset;
+		}
+	}
+
+	zdata->mapping.data_offsets = offsets;
+	return true;
+
+fail:
+	free(offsets);
+	return false;
+}
+
+static void vfs_zipfile_init_mapping(VFSNode *node) {
+	VFSZipFileData *zdata = node->data1;
+	char *syspath = vfs_node_syspath(zdata->source);
+
+	if(!syspath) {
+		return;
+	}
+
+	SDL_RWops *rw = vfs_node_open(zdata->source, VFS_MODE_READ);
+	int64_t size = rw ? SDL_RWsize(rw) : -1;
+
+	if(rw) {
+		SDL_RWclose(rw);
+	}
+
+	if(size > 0 && vfs_syspath_map_file(syspath, &zdata->mapping.file)) {
+		// Make sure libzip sees the same bytes; the source may be e.g. a decompressed view of this file.
+		if(zdata->mapping.file.size != size || !vfs_zipfile_index_mapping(zdata, vfs_zipfile_get_tls(node, true))) {
+			vfs_syspath_unmap_file(&zdata->mapping.file);
+		} else {
+			log_debug("%s: mapped into memory", syspath);
+		}
+	}
+
+	free(syspath);
+}
+
+const uint8_t *vfs_zipfile_get_mapped_data(VFSNode *zipnode, uint64_t idx, size_t size) {
+	VFSZipFileData *zdata = zipnode->data1;
+
+	if(!zdata->mapping.data_offsets) {
+		return NULL;
+	}
+
+	uint64_t offset = zdata->mapping.data_offsets[idx];
+
+	if(offset == 0 || offset + size > zdata->mapping.file.size) {
+		return NULL;
+	}
+
+	return zdata->mapping.file.data + offset;
+}
+
 VFSZipFileTLS* vfs_zipfile_get_tls(VFSNode *node, bool create) {
 	VFSZipFileData *zdata = node->data1;
 	VFSZipFileTLS *tls = SDL_TLSGet(zdata->tls_id);
@@ -352,6 +517,7 @@ bool vfs_zipfile_init(VFSNode *node, VFSNode *source) {
 	}
 
 	vfs_zipfile_init_pathmap(node);
+	vfs_zipfile_init_mapping(node);
 	return true;
 
 error:
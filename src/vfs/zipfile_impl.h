@@ -20,6 +20,7 @@ DIAGNOSTIC_CLANG(pop)
 #include "util/libzip_compat.h"
 
 #include "private.h"
+#include "syspath.h"
 #include "hashtable.h"
 
 /* zipfile */
@@ -34,6 +35,13 @@ typedef struct VFSZipFileData {
 	VFSNode *source;
 	ht_str2int_t pathmap;
 	SDL_TLSID tls_id;
+
+	// If the archive is a plain file on disk, it's mapped into memory, so that uncompressed
+	// members can be read directly, bypassing libzip.
+	struct {
+		VFSSyspathMapping file;
+		uint64_t *data_offsets;  // per entry; 0 if the entry can't be read from the mapping
+	} mapping;
 } VFSZipFileData;
 
 typedef struct VFSZipFileIterData {
@@ -61,4 +69,7 @@ typedef struct VFSZipPathData {
 void vfs_zippath_init(VFSNode *node, VFSNode *zipnode, zip_int64_t idx);
 VFSZipFileTLS* vfs_zipfile_get_tls(VFSNode *node, bool create);
 
+// Returns a pointer to the raw data of an uncompressed member, or NULL if it's not mapped.
+const uint8_t *vfs_zipfile_get_mapped_data(VFSNode *zipnode, uint64_t idx, size_t size);
+
 #endif // IGUARD_vfs_zipfile_impl_h